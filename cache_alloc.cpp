@@ -14,6 +14,10 @@
 #include <iostream>
 #include <chrono>
 #include <list>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cassert>
 
 #define BOOST_POOL_NO_MT
 #include <boost/pool/pool_alloc.hpp>
@@ -86,6 +90,40 @@ template <template <typename...> class C, typename A, size_t L>
        return std::chrono::duration<double>{end - start};
     }
 
+template <template <typename...> class C, typename A, size_t L>
+    auto test4()
+    {
+        C<int, A> c;
+        std::vector<typename C<int, A>::iterator> v;
+        
+        // one more than a multiple of the batch size so that the last deallocation is left for flush
+        for (size_t i = 0; i < L + 1; ++ i)
+        {
+            v.push_back(c.emplace(c.end(), int(i)));
+        }
+        
+        std::shuffle(v.begin(), v.end(), std::mt19937{});
+
+        auto start = std::chrono::steady_clock::now();
+        
+        {        
+            for (auto const & i : v)
+            {
+                c.erase(i);
+            }
+            
+            // the nodes come from the pool of the rebound allocator, which A cannot reach
+            fornux::pool_registry::instance().flush_all();
+        }
+        
+       auto end = std::chrono::steady_clock::now();
+       
+       for (auto const & o : fornux::pool_registry::instance().occupancy())
+           assert(o.deferred == 0);
+
+       return std::chrono::duration<double>{end - start};
+    }
+
 template <template <typename...> class C>
     void test()
     {
@@ -104,6 +142,8 @@ template <template <typename...> class C>
             cout << "cache_alloc of 10 K: " << s / test1<C, cache_alloc<int, 10>, LOOP_SIZE>() << "x    " << endl;
             cout << "cache_alloc of 100 K: " << s / test1<C, cache_alloc<int, 100>, LOOP_SIZE>() << "x    " << endl;
             cout << "cache_alloc of 1000 K: " << s / test1<C, cache_alloc<int, 1000>, LOOP_SIZE>() << "x    " << endl;
+            cout << "shared_cache_alloc of 1 K: " << s / test1<C, shared_cache_alloc<int, 1>, LOOP_SIZE>() << "x    " << endl;
+            cout << "shared_cache_alloc of 10 K: " << s / test1<C, shared_cache_alloc<int, 10>, LOOP_SIZE>() << "x    " << endl;
         }
     
         {
@@ -115,6 +155,8 @@ template <template <typename...> class C>
             cout << "cache_alloc of 10 K: " << s / test2<C, cache_alloc<int, 10>, LOOP_SIZE>() << "x    " << endl;
             cout << "cache_alloc of 100 K: " << s / test2<C, cache_alloc<int, 100>, LOOP_SIZE>() << "x    " << endl;
             cout << "cache_alloc of 1000 K: " << s / test2<C, cache_alloc<int, 1000>, LOOP_SIZE>() << "x    " << endl;
+            cout << "shared_cache_alloc of 1 K: " << s / test2<C, shared_cache_alloc<int, 1>, LOOP_SIZE>() << "x    " << endl;
+            cout << "shared_cache_alloc of 10 K: " << s / test2<C, shared_cache_alloc<int, 10>, LOOP_SIZE>() << "x    " << endl;
         }
     
         {
@@ -126,6 +168,18 @@ template <template <typename...> class C>
             cout << "cache_alloc of 10 K: " << s / test3<C, cache_alloc<int, 10>, LOOP_SIZE>() << "x    " << endl;
             cout << "cache_alloc of 100 K: " << s / test3<C, cache_alloc<int, 100>, LOOP_SIZE>() << "x    " << endl;
             cout << "cache_alloc of 1000 K: " << s / test3<C, cache_alloc<int, 1000>, LOOP_SIZE>() << "x    " << endl;
+            cout << "shared_cache_alloc of 1 K: " << s / test3<C, shared_cache_alloc<int, 1>, LOOP_SIZE>() << "x    " << endl;
+            cout << "shared_cache_alloc of 10 K: " << s / test3<C, shared_cache_alloc<int, 10>, LOOP_SIZE>() << "x    " << endl;
+        }
+    
+        {
+            cout << "shared_cache_alloc speedup factor (scattered erase):    " << endl;
+            
+            auto s = test4<C, shared_cache_alloc<int, 100>, LOOP_SIZE>();
+        
+            cout << "shared_cache_alloc of 100 K, batch of 16: " << s / test4<C, shared_cache_alloc<int, 100, allocator, 16>, LOOP_SIZE>() << "x    " << endl;
+            cout << "shared_cache_alloc of 100 K, batch of 64: " << s / test4<C, shared_cache_alloc<int, 100, allocator, 64>, LOOP_SIZE>() << "x    " << endl;
+            cout << "shared_cache_alloc of 100 K, batch of 256: " << s / test4<C, shared_cache_alloc<int, 100, allocator, 256>, LOOP_SIZE>() << "x    " << endl;
         }
     
         typedef fast_pool_allocator<int, default_user_allocator_new_delete, details::pool::default_mutex, 64, 128> boost_fast_allocator;
@@ -13,9 +13,19 @@
 #define CACHE_ALLOC_HPP
 
 #include <array>
+#include <algorithm>
 #include "list.hpp"
+#include "cache_tune.hpp"
+#include "cache_profile.hpp"
+#include "cache_occupancy.hpp"
+#include "cache_registry.hpp"
+#include "cache_checked.hpp"
 
-#if BOOST_BENCHMARK
+#if defined(BOOST_BENCHMARK) || defined(CACHE_ALLOC_TUNE)
+#define CACHE_ALLOC_STATS 1
+#endif
+
+#ifdef CACHE_ALLOC_STATS
 #include <iostream>
 
 #ifdef _WIN32
@@ -40,36 +50,61 @@ namespace fornux
 {
 
 
-template <typename T, size_t S, template <typename...> class A = std::allocator> // type, cache size based on speed of pre-made benchmark and allocator
-    struct cache_alloc
+/**
+    Size class of an element type.
+    
+    Types whose storage rounds up to the same size and alignment share the same cache layout and can therefore share the same pool.
+*/
+
+template <typename T>
+    struct size_class
+    {
+        static constexpr size_t alignment = alignof(T) > alignof(void *) ? alignof(T) : alignof(void *);
+        static constexpr size_t size = (sizeof(T) + alignment - 1) / alignment * alignment;
+    };
+
+
+template <size_t Z, size_t L, size_t S, template <typename...> class A = std::allocator, size_t B = 0, size_t P = 0> // element size, element alignment, cache size based on speed of pre-made benchmark, allocator, deferred deallocation batch size and slot alignment
+    struct cache_pool
     {
-        template <class, size_t, template <typename...> class> friend struct cache_alloc;
+        typedef typename std::aligned_storage<Z, L>::type storage_t;
         
-        typedef T value_type;
-        typedef T & reference;
-        typedef T const & const_reference;
-        typedef size_t size_type;
+        cache_pool() = default;
         
-        template <class U> 
-            struct rebind 
-            {
-                typedef cache_alloc<U, S, A> other;
-            };
-            
-        T * allocate(size_t size) noexcept __attribute__((always_inline))
+        // kept out of the pool_registry, for pools used concurrently under a lock of their owner or private to a thread
+        explicit cache_pool(unregistered_t) noexcept
+        : registration(false)
+        {
+        }
+        
+        // caches cannot be shared
+        cache_pool(cache_pool const &) = delete;
+        cache_pool & operator = (cache_pool const &) = delete;
+        
+        void * allocate(size_t size) noexcept __attribute__((always_inline))
         {
             typename fornux::list<cache_t, A<cache_t>>::iterator pcache;
+#ifdef CACHE_ALLOC_STATS
+
+            if (++ stats.live > stats.high_water)
+                stats.high_water = stats.live;
+#endif
 
             if (pool.dead_caches.empty())
             {
-#ifdef BOOST_BENCHMARK
+#ifdef CACHE_ALLOC_STATS
                 benchmark_t cache(stats.cache);
                 
+                ++ stats.created;
 #endif
                 // add a buffer
                 pool.caches.emplace_back();
                 
                 pcache = pool.caches.rbegin();
+#ifdef CACHE_ALLOC_CHECKED
+                pcache->owner = & pool;
+                poison(& pcache->data, sizeof(data_t));
+#endif
                 
                 pool.dead_caches.push_back(& pcache->pool_node);
             }
@@ -78,27 +113,33 @@ template <typename T, size_t S, template <typename...> class A = std::allocator>
                 pcache = boost::smart_ptr::detail::classof(& cache_t::pool_node, pool.dead_caches.rbegin());
             }
                         
-            if (pcache->live_elements_size < S * 1024)
+            if (pcache->dead_elements.empty())
             {
-#ifdef BOOST_BENCHMARK
+#ifdef CACHE_ALLOC_STATS
                 benchmark_t element(stats.element);
                 
 #endif
                 // create new element
-                element_t * const pelement = & reinterpret_cast<data_t &>(pcache->data)[pcache->live_elements_size];
+                element_t * const pelement = & reinterpret_cast<data_t &>(pcache->data)[pcache->new_elements_size ++];
+#ifdef CACHE_ALLOC_CHECKED
+                unpoison(pelement, sizeof(element_t));
+#endif
                 
                 pelement->pcache = pcache;
                 pelement->pcache->live_elements_size += size;
                 new (& pelement->cache_node) boost::smart_ptr::detail::intrusive_list_node();
+#ifdef CACHE_ALLOC_PROFILE
+                pelement->sample = nullptr;
+#endif
                 
-                if (pcache->live_elements_size >= S * 1024)
+                if (pcache->new_elements_size >= S * 1024)
                     pcache->pool_node.erase();
                 
-                return reinterpret_cast<T *>(& pelement->element);
+                return & pelement->element;
             }
             else
             {
-#ifdef BOOST_BENCHMARK
+#ifdef CACHE_ALLOC_STATS
                 benchmark_t element(stats.element);
                 
 #endif
@@ -106,20 +147,49 @@ template <typename T, size_t S, template <typename...> class A = std::allocator>
                 element_t * const pelement = boost::smart_ptr::detail::classof(& element_t::cache_node, pcache->dead_elements.begin());
                     
                 pelement->cache_node.erase();
+                pelement->pcache->live_elements_size += size;
+#ifdef CACHE_ALLOC_CHECKED
+                unpoison(& pelement->element, sizeof(storage_t));
+#endif
                 
-                if (pcache->dead_elements.empty())
+                if (pcache->dead_elements.empty() && pcache->new_elements_size >= S * 1024)
                     pcache->pool_node.erase();
                     
-                return reinterpret_cast<T *>(& pelement->element);
+                return & pelement->element;
             }
         }
         
-        void deallocate(T * q, size_t size) noexcept __attribute__((always_inline))
+        void deallocate(void * q, size_t size) noexcept __attribute__((always_inline))
         {
-            element_t * const pelement = boost::smart_ptr::detail::classof(& element_t::element, reinterpret_cast<typename std::aligned_storage<sizeof(T), alignof(T)>::type *>(q));
+#ifdef CACHE_ALLOC_STATS
+            -- stats.live;
+            
+#endif
+#ifdef CACHE_ALLOC_CHECKED
+            validate(q);
+            poison(q, sizeof(storage_t));
+            
+#endif
+            if (B)
+            {
+#ifdef CACHE_ALLOC_CHECKED
+                // mark as no longer live
+                boost::smart_ptr::detail::classof(& element_t::element, static_cast<storage_t *>(q))->cache_node.next = nullptr;
+                
+#endif
+                // defer until the buffer is full
+                deferred[deferred_size ++] = {q, size};
+                
+                if (deferred_size == B)
+                    flush();
+                    
+                return;
+            }
+            
+            element_t * const pelement = boost::smart_ptr::detail::classof(& element_t::element, static_cast<storage_t *>(q));
             
             {
-#ifdef BOOST_BENCHMARK
+#ifdef CACHE_ALLOC_STATS
                 benchmark_t element(stats.element);
                 
 #endif
@@ -132,33 +202,271 @@ template <typename T, size_t S, template <typename...> class A = std::allocator>
             
             if (pool.caches.size() > 1 && pelement->pcache->live_elements_size == 0)
             {
-#ifdef BOOST_BENCHMARK
+#ifdef CACHE_ALLOC_STATS
                 benchmark_t cache(stats.cache);
                 
+                ++ stats.released;
 #endif
                 // remove a buffer                
+#ifdef CACHE_ALLOC_CHECKED
+                unpoison(& pelement->pcache->data, sizeof(data_t));
+#endif
                 pool.caches.erase(pelement->pcache);
             }
         }
+        
+        // release the deferred elements, touching each cache once per batch
+        void flush() noexcept
+        {
+            if (! B)
+                return;
+                
+            std::sort(deferred.begin(), deferred.begin() + deferred_size, [] (deferred_t const & a, deferred_t const & b) { return std::less<void *>()(a.p, b.p); });
+            
+            for (size_t i = 0, j = 0; i < deferred_size; i = j)
+            {
+                typename fornux::list<cache_t, A<cache_t>>::iterator pcache = boost::smart_ptr::detail::classof(& element_t::element, static_cast<storage_t *>(deferred[i].p))->pcache;
+                
+                {
+#ifdef CACHE_ALLOC_STATS
+                    benchmark_t element(stats.element);
+                    
+#endif
+                    // enlist all elements of the same cache
+                    for (; j < deferred_size; ++ j)
+                    {
+                        element_t * const pelement = boost::smart_ptr::detail::classof(& element_t::element, static_cast<storage_t *>(deferred[j].p));
+                        
+                        if (pelement->pcache != pcache)
+                            break;
+                            
+                        pcache->live_elements_size -= deferred[j].size;
+                        pcache->dead_elements.push_back(& pelement->cache_node);
+                    }
+                    
+                    pcache->pool_node.erase();
+                    pool.dead_caches.push_back(& pcache->pool_node);
+                }
+                
+                if (pool.caches.size() > 1 && pcache->live_elements_size == 0)
+                {
+#ifdef CACHE_ALLOC_STATS
+                    benchmark_t cache(stats.cache);
+                    
+                    ++ stats.released;
+#endif
+                    // remove a buffer                
+#ifdef CACHE_ALLOC_CHECKED
+                    unpoison(& pcache->data, sizeof(data_t));
+#endif
+                    pool.caches.erase(pcache);
+                }
+            }
+            
+            deferred_size = 0;
+        }
+        
+        // moves up to n live elements out of the sparsest caches into the free slots of the others, calling relocate(from, to)
+        // for each, so that the former can be released; returns the number of elements moved
+        template <typename F>
+            size_t compact(size_t n, F relocate) noexcept
+            {
+                size_t moved = 0;
+                
+                flush();
+                
+                while (moved < n)
+                {
+                    typename fornux::list<cache_t, A<cache_t>>::iterator pcache = pool.caches.end();
+                    size_t live = 0;
+                    
+                    for (typename fornux::list<cache_t, A<cache_t>>::iterator i = pool.caches.begin(); i != pool.caches.end(); ++ i)
+                    {
+                        live += i->live_elements_size;
+                        
+                        if (i->live_elements_size && (pcache == pool.caches.end() || i->live_elements_size < pcache->live_elements_size))
+                            pcache = i;
+                    }
+                    
+                    // the other caches must have room for all of its elements
+                    if (pcache == pool.caches.end() || capacity() - live < S * 1024)
+                        break;
+                    
+                    // keep allocations out of it
+                    pcache->pool_node.erase();
+                    
+                    // resume where the last pass on this cache stopped
+                    for (size_t & i = pcache->evacuated; i < pcache->new_elements_size && pcache->live_elements_size && moved < n; ++ i)
+                    {
+                        element_t * const pelement = & reinterpret_cast<data_t &>(pcache->data)[i];
+                        
+                        // skip dead elements
+                        if (pelement->cache_node.next != & pelement->cache_node)
+                            continue;
+                        
+                        void * const q = allocate(1);
+#ifdef CACHE_ALLOC_STATS
+                        
+                        -- stats.live;
+#endif
+#ifdef CACHE_ALLOC_PROFILE
+                        
+                        sample(q) = pelement->sample;
+                        pelement->sample = nullptr;
+#endif
+                        
+                        relocate(static_cast<void *>(& pelement->element), q);
+                        
+                        pcache->live_elements_size -= 1;
+                        pcache->dead_elements.push_back(& pelement->cache_node);
+#ifdef CACHE_ALLOC_CHECKED
+                        poison(& pelement->element, sizeof(storage_t));
+#endif
+                        ++ moved;
+                    }
+                    
+                    if (pcache->live_elements_size == 0)
+                    {
+#ifdef CACHE_ALLOC_STATS
+                        benchmark_t cache(stats.cache);
+                        
+                        ++ stats.released;
+#endif
+                        // remove a buffer
+#ifdef CACHE_ALLOC_CHECKED
+                        unpoison(& pcache->data, sizeof(data_t));
+#endif
+                        pool.caches.erase(pcache);
+                    }
+                    else
+                    {
+                        // slots behind the cursor were reused since it started
+                        if (pcache->evacuated >= pcache->new_elements_size)
+                            pcache->evacuated = 0;
+                        
+                        // last in line for reuse until the next pass
+                        pool.dead_caches.push_front(& pcache->pool_node);
+                    }
+                }
+                
+                return moved;
+            }
+        
+        // elements the caches can hold
+        size_t capacity() noexcept
+        {
+            return pool.caches.size() * S * 1024;
+        }
+        
+#ifdef CACHE_ALLOC_CHECKED
+        // verifies the lists and counts of the whole pool
+        void check() noexcept
+        {
+            size_t open = 0, dead = 0;
+            
+            for (boost::smart_ptr::detail::intrusive_list::pointer p = pool.dead_caches.begin(); p != pool.dead_caches.end(); p = p->next, ++ dead)
+                if (p->next->prev != p || p->prev->next != p)
+                    checked_failure("corrupt dead_caches list", p);
+                    
+            for (typename fornux::list<cache_t, A<cache_t>>::iterator i = pool.caches.begin(); i != pool.caches.end(); ++ i)
+            {
+                size_t free = 0;
+                
+                if (i->owner != & pool)
+                    checked_failure("cache of another pool", & * i);
+                
+                for (boost::smart_ptr::detail::intrusive_list::pointer p = i->dead_elements.begin(); p != i->dead_elements.end(); p = p->next, ++ free)
+                {
+                    if (p->next->prev != p || p->prev->next != p)
+                        checked_failure("corrupt dead_elements list", p);
+                        
+                    if (free > S * 1024 || ! owns(* i, boost::smart_ptr::detail::classof(& element_t::cache_node, p)))
+                        checked_failure("foreign element in dead_elements list", p);
+                }
+                
+                if (free + i->live_elements_size + S * 1024 - i->new_elements_size != S * 1024)
+                    checked_failure("inconsistent element count", & * i);
+                    
+                if ((i->pool_node.next != & i->pool_node) != (free || i->new_elements_size < S * 1024))
+                    checked_failure("cache misfiled in dead_caches", & * i);
+                    
+                open += i->pool_node.next != & i->pool_node;
+            }
+            
+            if (open != dead)
+                checked_failure("foreign node in dead_caches list", & pool.dead_caches);
+        }
+        
+#endif
+        // walks every cache of the pool
+        occupancy_t occupancy()
+        {
+            occupancy_t o;
+            
+            o.element_size = sizeof(storage_t);
+            o.slot_size = sizeof(element_t);
+            o.deferred = deferred_size;
+            
+            for (typename fornux::list<cache_t, A<cache_t>>::iterator i = pool.caches.begin(); i != pool.caches.end(); ++ i)
+            {
+                size_t free = 0;
+                
+                for (boost::smart_ptr::detail::intrusive_list::pointer p = i->dead_elements.begin(); p != i->dead_elements.end(); p = p->next)
+                    ++ free;
+                    
+                o.caches.push_back({& i->data, S * 1024, i->live_elements_size, free, S * 1024 - i->new_elements_size, i->pool_node.next != & i->pool_node});
+            }
+            
+            return o;
+        }
+        
+#ifdef CACHE_ALLOC_PROFILE
+        static void *& sample(void * q) noexcept
+        {
+            return boost::smart_ptr::detail::classof(& element_t::element, static_cast<storage_t *>(q))->sample;
+        }
+        
+#endif
+        // process-wide registry: one pool per size class and context
+        template <typename C = void>
+            static cache_pool & instance()
+            {
+                static cache_pool p;
+                
+                return p;
+            }
 #ifdef BOOST_BENCHMARK
 
-        ~cache_alloc()
+        ~cache_pool()
         {
             if (double(stats.element.time + stats.cache.time) / double(stats.element.time) > 1.0)
                 std::cerr << "(buffer non-optimal) ";
         }
 #endif
 
-    private:
-#ifdef BOOST_BENCHMARK
+#ifdef CACHE_ALLOC_STATS
+
         struct stats_t
         {
             struct unit_t
             {
-                //size_t count{};
+                size_t count{};
                 uint64_t time{};
             } element, cache;
-        } stats;
+            
+            size_t live{}, high_water{}; // elements
+            size_t created{}, released{}; // caches
+        };
+        
+        stats_t const & statistics() const
+        {
+            return stats;
+        }
+#endif
+
+    private:
+#ifdef CACHE_ALLOC_STATS
+        stats_t stats;
 
         struct benchmark_t
         {
@@ -169,7 +477,7 @@ template <typename T, size_t S, template <typename...> class A = std::allocator>
             : start(rdtsc())
             , unit(unit)
             {
-                //++ unit.count;
+                ++ unit.count;
             }
             
             ~benchmark_t()
@@ -182,12 +490,20 @@ template <typename T, size_t S, template <typename...> class A = std::allocator>
         
 #endif
         struct cache_t;
+        struct pool_t;
+        
+        // slots padded to P bytes when it exceeds their natural alignment, to keep small objects used by different threads on
+        // cache lines of their own
+        static constexpr size_t slot_alignment = P > L && P > alignof(void *) ? P : L > alignof(void *) ? L : alignof(void *);
         
-        struct element_t
+        struct alignas(slot_alignment) element_t
         {
             boost::smart_ptr::detail::intrusive_list_node cache_node;
             typename fornux::list<cache_t, A<cache_t>>::iterator pcache;
-            typename std::aligned_storage<sizeof(T), alignof(T)>::type element;
+#ifdef CACHE_ALLOC_PROFILE
+            void * sample; // heap_profiler::sample_t of a sampled live element
+#endif
+            storage_t element;
         };
         
         typedef std::array<element_t, S * 1024> data_t;
@@ -195,6 +511,11 @@ template <typename T, size_t S, template <typename...> class A = std::allocator>
         struct cache_t
         {
             size_t live_elements_size{};
+            size_t new_elements_size{};
+            size_t evacuated{}; // compact() cursor
+#ifdef CACHE_ALLOC_CHECKED
+            pool_t const * owner{};
+#endif
             boost::smart_ptr::detail::intrusive_list_node pool_node;
             boost::smart_ptr::detail::intrusive_list dead_elements;
             typename std::aligned_storage<sizeof(data_t), alignof(data_t)>::type data;
@@ -208,12 +529,316 @@ template <typename T, size_t S, template <typename...> class A = std::allocator>
             pool_t()
             {
                 dead_caches.push_back(& caches.begin()->pool_node);
+#ifdef CACHE_ALLOC_CHECKED
+                caches.begin()->owner = this;
+                poison(& caches.begin()->data, sizeof(data_t));
+#endif
+            }
+#ifdef CACHE_ALLOC_CHECKED
+            
+            ~pool_t()
+            {
+                for (typename fornux::list<cache_t, A<cache_t>>::iterator i = caches.begin(); i != caches.end(); ++ i)
+                    unpoison(& i->data, sizeof(data_t));
+            }
+#endif
+        };
+        
+        struct deferred_t
+        {
+            void * p;
+            size_t size;
+        };
+        
+        // enlisted in the pool_registry for its lifetime, unless the owner synchronizes the pool itself
+        struct registration_t : pool_registry::node_t
+        {
+            bool const enlisted;
+            
+            registration_t(bool enlisted = true)
+            : enlisted(enlisted)
+            {
+                flush = [] (pool_registry::node_t * p) noexcept { boost::smart_ptr::detail::classof(& cache_pool::registration, static_cast<registration_t *>(p))->flush(); };
+                occupancy = [] (pool_registry::node_t * p) { return boost::smart_ptr::detail::classof(& cache_pool::registration, static_cast<registration_t *>(p))->occupancy(); };
+                
+                if (enlisted)
+                    pool_registry::instance().insert(this);
+            }
+            
+            ~registration_t()
+            {
+                if (enlisted)
+                    pool_registry::instance().erase(this);
             }
         };
         
         pool_t pool; // general pool
+        std::array<deferred_t, B> deferred; // deallocations pending flush
+        size_t deferred_size{};
+        registration_t registration; // last so that it is dropped first
+#ifdef CACHE_ALLOC_CHECKED
+        
+        static bool owns(cache_t const & cache, element_t const * pelement) noexcept
+        {
+            char const * const begin = reinterpret_cast<char const *>(& cache.data);
+            char const * const p = reinterpret_cast<char const *>(pelement);
+            
+            return p >= begin && p < begin + sizeof(data_t) && (p - begin) % sizeof(element_t) == 0;
+        }
+        
+        // aborts unless q is a live element of this pool
+        void validate(void * q) noexcept
+        {
+            element_t * const pelement = boost::smart_ptr::detail::classof(& element_t::element, static_cast<storage_t *>(q));
+            cache_t const & cache = * pelement->pcache;
+            
+            if (cache.owner != & pool || ! owns(cache, pelement))
+                checked_failure("deallocation of an element of another pool", q);
+                
+            if (pelement->cache_node.next != & pelement->cache_node)
+                checked_failure("double deallocation", q);
+                
+            if (cache.pool_node.next->prev != & cache.pool_node || cache.pool_node.prev->next != & cache.pool_node)
+                checked_failure("corrupt dead_caches list", & cache);
+        }
+#endif
+    };
+
+
+template <typename T, size_t S, template <typename...> class A = std::allocator, size_t B = 0, size_t P = 0> // type, cache size based on speed of pre-made benchmark, allocator, deferred deallocation batch size and slot alignment
+    struct cache_alloc
+    {
+        template <class, size_t, template <typename...> class, size_t, size_t> friend struct cache_alloc;
+        
+        typedef T value_type;
+        typedef T & reference;
+        typedef T const & const_reference;
+        typedef size_t size_type;
+        static constexpr size_t cache_size = S ? S : tuned_cache_size<T>(); // 0 picks the profile-guided size
+        
+        typedef cache_pool<size_class<T>::size, size_class<T>::alignment, cache_size, A, B, P> pool_type;
+        
+        template <class U> 
+            struct rebind 
+            {
+                typedef cache_alloc<U, S, A, B, P> other;
+            };
+        
+        // containers take their allocator along on assignment and swap, since nodes can only go back to their own pool
+        typedef std::true_type propagate_on_container_copy_assignment;
+        typedef std::true_type propagate_on_container_move_assignment;
+        typedef std::true_type propagate_on_container_swap;
+
+        cache_alloc()
+        : pool(std::make_shared<pool_type>())
+        {
+#ifdef CACHE_ALLOC_TUNE
+            tune_registry::instance();
+#endif
+#ifdef CACHE_ALLOC_PROFILE
+            heap_profiler::instance();
+#endif
+        }
+
+        // copies and moves share the pool
+        cache_alloc(cache_alloc const &) noexcept = default;
+        
+        // rebinds start with a pool of their own
+        template <class U>
+            cache_alloc(cache_alloc<U, S, A, B, P> const &)
+            : cache_alloc()
+            {
+            }
+#ifdef CACHE_ALLOC_TUNE
+        
+        ~cache_alloc()
+        {
+            if (pool.use_count() == 1)
+                tune_registry::instance().record<T>(size_class<T>::size, cache_size, pool->statistics());
+        }
+#endif
+
+        T * allocate(size_t size) noexcept __attribute__((always_inline))
+        {
+            // arrays (i.e. hash buckets) are not cached
+            if (size != 1)
+                return A<T>().allocate(size);
+                
+            T * p = static_cast<T *>(pool->allocate(size));
+#ifdef CACHE_ALLOC_PROFILE
+            
+            if (heap_profiler::sample(sizeof(T)))
+                pool_type::sample(p) = heap_profiler::instance().record<T>(sizeof(T));
+#endif
+            
+            return p;
+        }
+        
+        void deallocate(T * q, size_t size) noexcept __attribute__((always_inline))
+        {
+            if (size != 1)
+                return A<T>().deallocate(q, size);
+#ifdef CACHE_ALLOC_PROFILE
+            
+            if (void *& sample = pool_type::sample(q))
+            {
+                heap_profiler::instance().erase(sample);
+                sample = nullptr;
+            }
+#endif
+                
+            pool->deallocate(q, size);
+        }
+        
+        void flush() noexcept
+        {
+            pool->flush();
+        }
+        
+        occupancy_t occupancy()
+        {
+            return pool->occupancy();
+        }
+#ifdef CACHE_ALLOC_CHECKED
+        
+        void check() noexcept
+        {
+            pool->check();
+        }
+#endif
+        
+        template <class U>
+            bool operator == (cache_alloc<U, S, A, B, P> const & x) const noexcept
+            {
+                return static_cast<void const *>(pool.get()) == static_cast<void const *>(x.pool.get());
+            }
+        
+        template <class U>
+            bool operator != (cache_alloc<U, S, A, B, P> const & x) const noexcept
+            {
+                return ! (* this == x);
+            }
+
+    private:
+        std::shared_ptr<pool_type> pool; // general pool, shared by copies
     };
 
+
+/**
+    Shared cache allocator.
+    
+    Same as cache_alloc but all instances and rebinds of equal size class and context C draw from the same process-wide pool
+    instead of owning one each, so that std::map<int, int> and std::set<long> nodes share their caches.
+    
+    Pools are not synchronized.  cache_alloc containers own their pools, so containers confined to different threads are
+    independent; here every container whose node type falls in the same size class shares one pool, even containers of unrelated
+    types.  All containers of a given size class and context must therefore be confined to a single thread: give the containers
+    of each thread a context of their own, e.g. shared_cache_alloc<T, 10, std::allocator, 0, 0, struct worker_1>.
+*/
+
+template <typename T, size_t S, template <typename...> class A = std::allocator, size_t B = 0, size_t P = 0, typename C = void> // type, cache size based on speed of pre-made benchmark, allocator, deferred deallocation batch size, slot alignment and context
+    struct shared_cache_alloc
+    {
+        template <class, size_t, template <typename...> class, size_t, size_t, typename> friend struct shared_cache_alloc;
+        
+        typedef T value_type;
+        typedef T & reference;
+        typedef T const & const_reference;
+        typedef size_t size_type;
+        static constexpr size_t cache_size = S;
+        
+        // the tuned size is per type, so rebinds of one size class would pick different pools
+        static_assert(S != 0, "shared_cache_alloc needs an explicit cache size");
+        
+        typedef cache_pool<size_class<T>::size, size_class<T>::alignment, cache_size, A, B, P> pool_type;
+        
+        template <class U> 
+            struct rebind 
+            {
+                typedef shared_cache_alloc<U, S, A, B, P, C> other;
+            };
+        
+        // instantiate the pool first so that it outlives static containers
+        shared_cache_alloc() noexcept
+        : pool(& pool_type::template instance<C>())
+        {
+#ifdef CACHE_ALLOC_PROFILE
+            heap_profiler::instance();
+#endif
+        }
+        
+        template <class U>
+            shared_cache_alloc(shared_cache_alloc<U, S, A, B, P, C> const &) noexcept
+            : shared_cache_alloc()
+            {
+            }
+            
+        T * allocate(size_t size) noexcept __attribute__((always_inline))
+        {
+            // arrays (i.e. hash buckets) are not cached
+            if (size != 1)
+                return A<T>().allocate(size);
+                
+            T * p = static_cast<T *>(pool->allocate(size));
+#ifdef CACHE_ALLOC_PROFILE
+            
+            if (heap_profiler::sample(sizeof(T)))
+                pool_type::sample(p) = heap_profiler::instance().record<T>(sizeof(T));
+#endif
+            
+            return p;
+        }
+        
+        void deallocate(T * q, size_t size) noexcept __attribute__((always_inline))
+        {
+            if (size != 1)
+                return A<T>().deallocate(q, size);
+#ifdef CACHE_ALLOC_PROFILE
+            
+            if (void *& sample = pool_type::sample(q))
+            {
+                heap_profiler::instance().erase(sample);
+                sample = nullptr;
+            }
+#endif
+                
+            pool->deallocate(q, size);
+        }
+        
+        void flush() noexcept
+        {
+            pool->flush();
+        }
+        
+        occupancy_t occupancy()
+        {
+            return pool->occupancy();
+        }
+#ifdef CACHE_ALLOC_CHECKED
+        
+        void check() noexcept
+        {
+            pool->check();
+        }
+#endif
+        
+        template <class U>
+            bool operator == (shared_cache_alloc<U, S, A, B, P, C> const &) const noexcept
+            {
+                return std::is_same<pool_type, typename shared_cache_alloc<U, S, A, B, P, C>::pool_type>::value;
+            }
+        
+        template <class U>
+            bool operator != (shared_cache_alloc<U, S, A, B, P, C> const & x) const noexcept
+            {
+                return ! (* this == x);
+            }
+
+    private:
+        pool_type * pool; // shared pool
+    };
+
+
 }
 
 
@@ -0,0 +1,464 @@
+/**
+    Cache Alloc Benchmark Suite
+
+    Copyright 2021 Phil Bouchard <phil@fornux.com>
+
+    Distributed under the Boost Software License, Version 1.0.
+    See accompanying file LICENSE_1_0.txt or copy at
+    http://www.boost.org/LICENSE_1_0.txt
+
+    Usage: cache_bench [live set size] [maximum threads] [churn operations]
+
+    Runs every container / allocator / object size / access pattern / thread count combination in a forked process of its own
+    and writes one CSV line per run: throughput, peak RSS growth and hardware cache / dTLB misses (-1 when perf events are not
+    available).  Each thread works on a container of its own.
+*/
+
+
+#include "cache_alloc.hpp"
+
+#include <iostream>
+#include <chrono>
+#include <list>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <vector>
+#include <random>
+#include <thread>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include <boost/pool/pool_alloc.hpp>
+
+
+template <size_t N>
+    struct blob
+    {
+        uint32_t key;
+        char pad[N - sizeof(uint32_t)];
+
+        blob(uint32_t key = 0) : key(key)
+        {
+        }
+
+        bool operator < (blob const & x) const
+        {
+            return key < x.key;
+        }
+    };
+
+template <>
+    struct blob<sizeof(uint32_t)>
+    {
+        uint32_t key;
+
+        blob(uint32_t key = 0) : key(key)
+        {
+        }
+
+        bool operator < (blob const & x) const
+        {
+            return key < x.key;
+        }
+    };
+
+
+// allocators
+
+struct std_allocator
+{
+    static constexpr char const * name = "std::allocator";
+
+    template <typename T>
+        using type = std::allocator<T>;
+};
+
+struct cache_allocator
+{
+    static constexpr char const * name = "cache_alloc<10>";
+
+    template <typename T>
+        using type = fornux::cache_alloc<T, 10>;
+};
+
+struct boost_fast_allocator
+{
+    static constexpr char const * name = "boost::fast_pool_allocator";
+
+    template <typename T>
+        using type = boost::fast_pool_allocator<T>;
+};
+
+
+// containers
+
+struct std_list
+{
+    static constexpr char const * name = "std::list";
+
+    template <size_t N, typename F>
+        struct type
+        {
+            typedef std::list<blob<N>, typename F::template type<blob<N>>> container;
+            typedef typename container::iterator handle;
+
+            static handle insert(container & c, uint32_t k)
+            {
+                return c.emplace(c.end(), k);
+            }
+
+            static void erase(container & c, handle h)
+            {
+                c.erase(h);
+            }
+        };
+};
+
+struct std_map
+{
+    static constexpr char const * name = "std::map";
+
+    template <size_t N, typename F>
+        struct type
+        {
+            typedef std::map<uint32_t, blob<N>, std::less<uint32_t>, typename F::template type<std::pair<uint32_t const, blob<N>>>> container;
+            typedef typename container::iterator handle;
+
+            static handle insert(container & c, uint32_t k)
+            {
+                return c.emplace(k, k).first;
+            }
+
+            static void erase(container & c, handle h)
+            {
+                c.erase(h);
+            }
+        };
+};
+
+struct std_unordered_map
+{
+    static constexpr char const * name = "std::unordered_map";
+
+    template <size_t N, typename F>
+        struct type
+        {
+            typedef std::unordered_map<uint32_t, blob<N>, std::hash<uint32_t>, std::equal_to<uint32_t>, typename F::template type<std::pair<uint32_t const, blob<N>>>> container;
+            typedef typename container::iterator handle;
+
+            static handle insert(container & c, uint32_t k)
+            {
+                return c.emplace(k, k).first;
+            }
+
+            static void erase(container & c, handle h)
+            {
+                c.erase(h);
+            }
+        };
+};
+
+struct std_set
+{
+    static constexpr char const * name = "std::set";
+
+    template <size_t N, typename F>
+        struct type
+        {
+            typedef std::set<blob<N>, std::less<blob<N>>, typename F::template type<blob<N>>> container;
+            typedef typename container::iterator handle;
+
+            static handle insert(container & c, uint32_t k)
+            {
+                return c.emplace(k).first;
+            }
+
+            static void erase(container & c, handle h)
+            {
+                c.erase(h);
+            }
+        };
+};
+
+struct fornux_list
+{
+    static constexpr char const * name = "fornux::list";
+
+    template <size_t N, typename F>
+        struct type
+        {
+            typedef fornux::list<blob<N>, typename F::template type<blob<N>>> container;
+            typedef typename container::iterator handle;
+
+            static handle insert(container & c, uint32_t k)
+            {
+                c.emplace_back(k);
+
+                return c.rbegin();
+            }
+
+            static void erase(container & c, handle h)
+            {
+                c.erase(h);
+            }
+        };
+};
+
+
+// access patterns
+
+enum pattern_t
+{
+    fifo,
+    lifo,
+    random_free,
+    churn
+};
+
+char const * const pattern_name[] = {"fifo", "lifo", "random", "churn"};
+
+
+struct options_t
+{
+    size_t live = 100000;
+    size_t threads = std::thread::hardware_concurrency();
+    size_t churn = 400000;
+};
+
+
+struct counter_t
+{
+    int fd;
+
+    counter_t(uint32_t type, uint64_t config)
+    {
+        perf_event_attr attr{};
+
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        fd = syscall(SYS_perf_event_open, & attr, 0, -1, -1, 0);
+    }
+
+    void start()
+    {
+        if (fd >= 0)
+        {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+
+    long long stop()
+    {
+        long long value = -1;
+
+        if (fd >= 0)
+        {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+
+            if (read(fd, & value, sizeof(value)) != sizeof(value))
+                value = -1;
+        }
+
+        return value;
+    }
+
+    ~counter_t()
+    {
+        if (fd >= 0)
+            close(fd);
+    }
+};
+
+
+template <typename D>
+    size_t run(pattern_t pattern, options_t const & o, unsigned seed)
+    {
+        typename D::container c;
+        std::vector<typename D::handle> h;
+        std::mt19937 g(seed);
+        uint32_t key = 0;
+        size_t ops = 0;
+
+        h.reserve(o.live);
+
+        for (size_t i = 0; i < o.live; ++ i, ++ ops)
+            h.push_back(D::insert(c, key ++));
+
+        switch (pattern)
+        {
+        case fifo:
+            break;
+
+        case lifo:
+            std::reverse(h.begin(), h.end());
+            break;
+
+        case random_free:
+            std::shuffle(h.begin(), h.end(), g);
+            break;
+
+        case churn:
+            // steady state: the live set size stays fixed
+            for (size_t i = 0; i < o.churn; ++ i, ops += 2)
+            {
+                size_t j = g() % h.size();
+
+                D::erase(c, h[j]);
+                h[j] = D::insert(c, key ++);
+            }
+            break;
+        }
+
+        for (auto const & i : h)
+        {
+            D::erase(c, i);
+            ++ ops;
+        }
+
+        return ops;
+    }
+
+inline long rss()
+{
+    long size = 0, resident = 0;
+
+    if (FILE * f = fopen("/proc/self/statm", "r"))
+    {
+        if (fscanf(f, "%ld %ld", & size, & resident) != 2)
+            resident = 0;
+
+        fclose(f);
+    }
+
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+template <size_t N, typename C, typename F>
+    void measure(pattern_t pattern, size_t threads, options_t const & o)
+    {
+        typedef typename C::template type<N, F> D;
+
+        std::cout.flush();
+
+        pid_t pid = fork();
+
+        if (pid < 0)
+        {
+            std::cerr << C::name << "," << F::name << "," << N << "," << pattern_name[pattern] << "," << threads << ": fork failed" << std::endl;
+            return;
+        }
+
+        if (pid > 0)
+        {
+            int status = 0;
+
+            // the row is missing unless the child ran to completion
+            if (waitpid(pid, & status, 0) != pid)
+                std::cerr << C::name << "," << F::name << "," << N << "," << pattern_name[pattern] << "," << threads << ": waitpid failed" << std::endl;
+            else if (WIFSIGNALED(status))
+                std::cerr << C::name << "," << F::name << "," << N << "," << pattern_name[pattern] << "," << threads << ": killed by signal " << WTERMSIG(status) << std::endl;
+            else if (! WIFEXITED(status) || WEXITSTATUS(status) != 0)
+                std::cerr << C::name << "," << F::name << "," << N << "," << pattern_name[pattern] << "," << threads << ": exited with status " << WEXITSTATUS(status) << std::endl;
+
+            return;
+        }
+
+        long rss_start = rss();
+        counter_t cache_misses(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+        counter_t dtlb_misses(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+        std::vector<size_t> ops(threads);
+        std::vector<std::thread> pool;
+
+        cache_misses.start();
+        dtlb_misses.start();
+
+        auto start = std::chrono::steady_clock::now();
+
+        for (size_t i = 0; i < threads; ++ i)
+            pool.emplace_back([& ops, i, pattern, & o] { ops[i] = run<D>(pattern, o, i); });
+
+        for (auto & t : pool)
+            t.join();
+
+        auto end = std::chrono::steady_clock::now();
+
+        long long cache = cache_misses.stop();
+        long long dtlb = dtlb_misses.stop();
+
+        rusage usage;
+        getrusage(RUSAGE_SELF, & usage);
+
+        size_t total = 0;
+
+        for (auto i : ops)
+            total += i;
+
+        double seconds = std::chrono::duration<double>{end - start}.count();
+
+        std::cout << C::name << "," << F::name << "," << N << "," << pattern_name[pattern] << "," << threads << "," << total << "," << seconds << "," << total / seconds / 1e6 << "," << usage.ru_maxrss - rss_start << "," << cache << "," << dtlb << std::endl;
+
+        _exit(0);
+    }
+
+template <size_t N, typename C, typename F>
+    void bench(options_t const & o)
+    {
+        for (pattern_t pattern : {fifo, lifo, random_free, churn})
+            for (size_t threads = 1; threads <= o.threads; threads *= 2)
+                measure<N, C, F>(pattern, threads, o);
+    }
+
+template <size_t N, typename C, typename... F>
+    void bench_allocators(options_t const & o)
+    {
+        (bench<N, C, F>(o), ...);
+    }
+
+template <size_t N, typename... C>
+    void bench_containers(options_t const & o)
+    {
+        (bench_allocators<N, C, std_allocator, cache_allocator, boost_fast_allocator>(o), ...);
+    }
+
+template <size_t... N>
+    void bench_sizes(options_t const & o)
+    {
+        (bench_containers<N, std_list, std_map, std_unordered_map, std_set, fornux_list>(o), ...);
+    }
+
+int main(int argc, char * argv[])
+{
+    options_t o;
+
+    if (argc > 1)
+        o.live = std::strtoul(argv[1], nullptr, 10);
+    if (argc > 2)
+        o.threads = std::strtoul(argv[2], nullptr, 10);
+    if (argc > 3)
+        o.churn = std::strtoul(argv[3], nullptr, 10);
+    if (o.threads == 0)
+        o.threads = 1;
+
+    std::cout << "container,allocator,object_size,pattern,threads,operations,seconds,mops_per_second,rss_kb,cache_misses,dtlb_misses" << std::endl;
+
+    bench_sizes<4, 8, 16, 32, 64, 128, 256, 512>(o);
+
+    return 0;
+}
@@ -0,0 +1,171 @@
+/**
+    Cache Checked Test
+
+    Copyright 2021 Phil Bouchard <phil@fornux.com>
+
+    Distributed under the Boost Software License, Version 1.0.
+    See accompanying file LICENSE_1_0.txt or copy at
+    http://www.boost.org/LICENSE_1_0.txt
+
+    Build with: g++ -std=c++17 -g -DCACHE_ALLOC_CHECKED -fsanitize=address cache_checked.cpp
+    
+    Each fault runs in a child process, which must die with the expected diagnostic.
+*/    
+
+
+#ifndef CACHE_ALLOC_CHECKED
+#error "build with -DCACHE_ALLOC_CHECKED"
+#endif
+
+#include "cache_alloc.hpp"
+
+#include <iostream>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include <sys/wait.h>
+
+
+using namespace fornux;
+
+typedef cache_alloc<long, 1> alloc_t;
+
+void double_deallocation()
+{
+    alloc_t a;
+    long * p = a.allocate(1);
+    
+    a.deallocate(p, 1);
+    a.deallocate(p, 1);
+}
+
+void deferred_double_deallocation()
+{
+    cache_alloc<long, 1, std::allocator, 16> a;
+    long * p = a.allocate(1);
+    
+    a.deallocate(p, 1);
+    a.deallocate(p, 1);
+}
+
+void foreign_deallocation()
+{
+    alloc_t a, b;
+    long * p = a.allocate(1);
+    
+    b.deallocate(p, 1);
+}
+
+void use_after_free()
+{
+    alloc_t a;
+    long * p = a.allocate(1);
+    
+    a.deallocate(p, 1);
+    
+    std::cout << * static_cast<long volatile *>(p);
+}
+
+void overflow()
+{
+    alloc_t a;
+    long * p = a.allocate(1);
+    long * q = a.allocate(1);
+    
+    a.deallocate(q, 1);
+    
+    // overrun p into the list node heading the next slot, which the sanitizers cannot see
+    void ** node = reinterpret_cast<void **>(p + 1);
+    
+    node[0] = node;
+    
+    a.check();
+}
+
+// check() accepts a healthy pool
+bool healthy()
+{
+    alloc_t a;
+    long * p[3000];
+    
+    for (long *& i : p)
+        i = a.allocate(1);
+    
+    for (size_t i = 0; i < 3000; i += 2)
+        a.deallocate(p[i], 1);
+    
+    a.check();
+    
+    for (size_t i = 1; i < 3000; i += 2)
+        a.deallocate(p[i], 1);
+    
+    a.check();
+    
+    return true;
+}
+
+// runs f in a child process and looks for what in its diagnostic
+bool detected(void (* f)(), char const * what)
+{
+    int fd[2];
+    
+    if (pipe(fd) != 0)
+        return false;
+    
+    pid_t pid = fork();
+    
+    if (pid == 0)
+    {
+        dup2(fd[1], STDERR_FILENO);
+        close(fd[0]);
+        
+        f();
+        
+        _exit(0);
+    }
+    
+    close(fd[1]);
+    
+    std::string out;
+    char buffer[4096];
+    
+    for (ssize_t n; (n = read(fd[0], buffer, sizeof(buffer))) > 0; )
+        out.append(buffer, n);
+    
+    close(fd[0]);
+    
+    int status;
+    
+    waitpid(pid, & status, 0);
+    
+    return ! (WIFEXITED(status) && WEXITSTATUS(status) == 0) && out.find(what) != std::string::npos;
+}
+
+int main()
+{
+    using namespace std;
+    
+    bool ok = true;
+    
+    auto report = [& ok] (char const * name, bool passed)
+    {
+        cout << name << ": " << (passed ? "detected" : "MISSED") << "    " << endl;
+        
+        ok = ok && passed;
+    };
+    
+    cout << "cache_alloc checked mode:    " << endl;
+    cout << "healthy pool: " << (healthy() ? "passed" : "failed") << "    " << endl;
+    
+    report("double deallocation", detected(double_deallocation, "double deallocation"));
+    report("deferred double deallocation", detected(deferred_double_deallocation, "double deallocation"));
+    report("deallocation through another pool", detected(foreign_deallocation, "deallocation of an element of another pool"));
+    report("corrupt free list", detected(overflow, "corrupt dead_elements list"));
+#ifdef CACHE_ALLOC_ASAN
+    report("use after free", detected(use_after_free, "use-after-poison"));
+#else
+    cout << "use after free: skipped, needs -fsanitize=address    " << endl;
+#endif
+    
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,86 @@
+/**
+    Cache Checked
+
+    Copyright 2021 Phil Bouchard <phil@fornux.com>
+
+    Distributed under the Boost Software License, Version 1.0.
+    See accompanying file LICENSE_1_0.txt or copy at
+    http://www.boost.org/LICENSE_1_0.txt
+
+    Checked mode, built in with -DCACHE_ALLOC_CHECKED:
+    - the storage of free elements is poisoned for AddressSanitizer and Valgrind so that use after free is reported;
+    - double deallocations, deallocations through the wrong pool and broken lists abort with a diagnostic.
+
+    None of it is compiled in otherwise.
+*/
+
+
+#ifndef CACHE_CHECKED_HPP
+#define CACHE_CHECKED_HPP
+
+#ifdef CACHE_ALLOC_CHECKED
+#include <cstdio>
+#include <cstdlib>
+#include <cstddef>
+
+#if defined(__SANITIZE_ADDRESS__)
+#define CACHE_ALLOC_ASAN 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define CACHE_ALLOC_ASAN 1
+#endif
+#endif
+
+#ifdef CACHE_ALLOC_ASAN
+#include <sanitizer/asan_interface.h>
+#endif
+
+#if defined(__has_include)
+#if __has_include(<valgrind/memcheck.h>)
+#include <valgrind/memcheck.h>
+#define CACHE_ALLOC_VALGRIND 1
+#endif
+#endif
+
+
+namespace fornux
+{
+
+
+inline void poison(void const * p, size_t size)
+{
+#ifdef CACHE_ALLOC_ASAN
+    ASAN_POISON_MEMORY_REGION(p, size);
+#endif
+#ifdef CACHE_ALLOC_VALGRIND
+    VALGRIND_MAKE_MEM_NOACCESS(p, size);
+#endif
+    (void) p;
+    (void) size;
+}
+
+inline void unpoison(void const * p, size_t size)
+{
+#ifdef CACHE_ALLOC_ASAN
+    ASAN_UNPOISON_MEMORY_REGION(p, size);
+#endif
+#ifdef CACHE_ALLOC_VALGRIND
+    VALGRIND_MAKE_MEM_UNDEFINED(p, size);
+#endif
+    (void) p;
+    (void) size;
+}
+
+[[noreturn]] inline void checked_failure(char const * what, void const * p)
+{
+    std::fprintf(stderr, "cache_alloc: %s (%p)\n", what, p);
+    std::abort();
+}
+
+
+}
+
+#endif
+
+
+#endif
@@ -0,0 +1,81 @@
+/**
+    Cache Alloc Contention Benchmark
+
+    Copyright 2021 Phil Bouchard <phil@fornux.com>
+
+    Distributed under the Boost Software License, Version 1.0.
+    See accompanying file LICENSE_1_0.txt or copy at
+    http://www.boost.org/LICENSE_1_0.txt
+*/    
+
+
+#include "cache_alloc.hpp"
+
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <thread>
+
+
+// per-connection state: one small object allocated by a thread and then used by another
+struct state_t
+{
+    long value;
+};
+
+template <typename A, size_t L>
+    auto test(size_t threads)
+    {
+        A a;
+        std::vector<state_t *> s;
+        std::vector<std::thread> pool;
+        
+        for (size_t i = 0; i < threads; ++ i)
+        {
+            s.push_back(new (a.allocate(1)) state_t{});
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        
+        {
+            for (size_t i = 0; i < threads; ++ i)
+            {
+                pool.emplace_back([p = static_cast<state_t volatile *>(s[i])] { for (size_t j = 0; j < L; ++ j) p->value = p->value + 1; });
+            }
+            
+            for (auto & t : pool)
+            {
+                t.join();
+            }
+        }
+        
+        auto end = std::chrono::steady_clock::now();
+        
+        for (auto p : s)
+        {
+            a.deallocate(p, 1);
+        }
+
+        return std::chrono::duration<double>{end - start};
+    }
+
+int main()
+{
+    using namespace std;
+    using namespace fornux;
+    
+    size_t const LOOP_SIZE = 1024 * 1000 * 100;
+    
+    for (size_t threads = 2; threads <= max(2u, thread::hardware_concurrency()); threads *= 2)
+    {
+        cout << "cache_alloc speedup factor (" << threads << " threads):    " << endl;
+        
+        auto s = test<allocator<state_t>, LOOP_SIZE>(threads);
+        
+        cout << "cache_alloc of 1 K: " << s / test<cache_alloc<state_t, 1>, LOOP_SIZE>(threads) << "x    " << endl;
+        cout << "cache_alloc of 1 K, 64 B slots: " << s / test<cache_alloc<state_t, 1, allocator, 0, 64>, LOOP_SIZE>(threads) << "x    " << endl;
+        cout << "cache_alloc of 1 K, 128 B slots: " << s / test<cache_alloc<state_t, 1, allocator, 0, 128>, LOOP_SIZE>(threads) << "x    " << endl;
+    }
+    
+    return 0;
+}
@@ -0,0 +1,117 @@
+/**
+    Cache Handle Benchmark
+
+    Copyright 2021 Phil Bouchard <phil@fornux.com>
+
+    Distributed under the Boost Software License, Version 1.0.
+    See accompanying file LICENSE_1_0.txt or copy at
+    http://www.boost.org/LICENSE_1_0.txt
+*/    
+
+
+#include "cache_handle.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <malloc.h>
+
+
+struct blob
+{
+    long value[8];
+};
+
+// resident set in KB
+size_t rss()
+{
+    size_t size = 0, resident = 0;
+    
+    std::ifstream("/proc/self/statm") >> size >> resident;
+    
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+// a spike of L objects of which 1 in 10 survive, followed by L steady creations and destructions
+template <typename P, size_t L>
+    void test(std::string const & name, bool compact)
+    {
+        P p;
+        std::vector<typename P::handle_t> h;
+        std::mt19937 g(1);
+        
+        for (size_t i = 0; i < L; ++ i)
+        {
+            h.push_back(p.create(blob{{long(i)}}));
+        }
+        
+        std::shuffle(h.begin(), h.end(), g);
+        
+        for (size_t i = L / 10; i < L; ++ i)
+        {
+            p.destroy(h[i]);
+        }
+        
+        h.resize(L / 10);
+        
+        size_t const peak = p.occupancy().caches.size();
+        
+        auto start = std::chrono::steady_clock::now();
+        
+        if (compact)
+            p.compact();
+        
+        for (size_t i = 0; i < L; ++ i)
+        {
+            size_t const j = g() % h.size();
+            
+            p.destroy(h[j]);
+            h[j] = p.create(blob{{long(i)}});
+        }
+        
+        auto end = std::chrono::steady_clock::now();
+        
+        // hand the released caches back to the system rather than keeping them in the malloc arena
+        malloc_trim(0);
+        
+        long sum = 0;
+        
+        for (auto i : h)
+            sum += p[i].value[0];
+        
+        std::cout << name << ": " << peak << " -> " << p.occupancy().caches.size() << " caches, " << rss() << " KB resident, " << std::chrono::duration<double>{end - start}.count() << " s (" << sum << ")    " << std::endl;
+    }
+
+int main(int argc, char * argv[])
+{
+    using namespace std;
+    using namespace fornux;
+    
+    size_t const LOOP_SIZE = 1024 * 1000;
+    
+    // one process per run so that resident sets do not add up
+    string const run = argc > 1 ? argv[1] : "";
+    
+    if (run.empty())
+    {
+        for (char const * r : {"none", "compact", "incremental"})
+            if (system((string(argv[0]) + " " + r).c_str()) != 0)
+                return 1;
+        
+        return 0;
+    }
+    
+    cout << "handle_pool compaction after a spike:    " << endl;
+    
+    if (run == "none")
+        test<handle_pool<blob, 10>, LOOP_SIZE>("no compaction", false);
+    else if (run == "compact")
+        test<handle_pool<blob, 10>, LOOP_SIZE>("compact()", true);
+    else
+        test<handle_pool<blob, 10, allocator, 16>, LOOP_SIZE>("16 per creation", false);
+    
+    return 0;
+}
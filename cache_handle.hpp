@@ -0,0 +1,164 @@
+/**
+    Cache Handle
+
+    Copyright 2021 Phil Bouchard <phil@fornux.com>
+
+    Distributed under the Boost Software License, Version 1.0.
+    See accompanying file LICENSE_1_0.txt or copy at
+    http://www.boost.org/LICENSE_1_0.txt
+*/
+
+
+#ifndef CACHE_HANDLE_HPP
+#define CACHE_HANDLE_HPP
+
+#include <new>
+#include <limits>
+#include <vector>
+#include <utility>
+#include <type_traits>
+#include "cache_alloc.hpp"
+
+
+namespace fornux
+{
+
+
+/**
+    Relocatable pool.
+
+    Objects are reached through stable handles indexing a table of addresses rather than through pointers, so that the pool can
+    move them out of sparse caches into dense ones and release the former: a cache is otherwise only released once all of its
+    elements are dead, which keeps memory at its high-water mark after a spike.  compact() relocates on demand and, when R is
+    non-zero, create() relocates up to R objects whenever a whole cache worth of slots is free.
+
+    References returned by operator [] are invalidated by compact() and, when R is non-zero, by create().  Like cache_alloc it
+    is not thread-safe.
+*/
+
+template <typename T, size_t S, template <typename...> class A = std::allocator, size_t R = 0> // type, cache size based on speed of pre-made benchmark, allocator and objects relocated per creation
+    struct handle_pool
+    {
+        static_assert(std::is_nothrow_move_constructible<T>::value, "T must be nothrow move constructible");
+        
+        static constexpr size_t cache_size = S ? S : tuned_cache_size<T>(); // 0 picks the profile-guided size
+        
+        struct handle_t
+        {
+            size_t index;
+        };
+        
+        handle_pool() = default;
+        
+        // the slots belong to the pool, which cannot be shared
+        handle_pool(handle_pool const &) = delete;
+        handle_pool & operator = (handle_pool const &) = delete;
+        
+        ~handle_pool()
+        {
+            for (slot_t * p : table)
+                if (p)
+                    value(p).~T();
+        }
+        
+        template <typename... Args>
+            handle_t create(Args &&... args)
+            {
+                if (R && live + cache_size * 1024 <= pool.capacity())
+                    compact(R);
+                
+                slot_t * const p = static_cast<slot_t *>(pool.allocate(1));
+                
+                new (& p->value) T(std::forward<Args>(args)...);
+                
+                if (free_handles.empty())
+                {
+                    p->handle = table.size();
+                    table.push_back(p);
+                }
+                else
+                {
+                    p->handle = free_handles.back();
+                    free_handles.pop_back();
+                    table[p->handle] = p;
+                }
+                
+                ++ live;
+                
+                return {p->handle};
+            }
+        
+        void destroy(handle_t h) noexcept
+        {
+            slot_t * const p = table[h.index];
+            
+            value(p).~T();
+            pool.deallocate(p, 1);
+            
+            table[h.index] = nullptr;
+            free_handles.push_back(h.index);
+            
+            -- live;
+        }
+        
+        T & operator [] (handle_t h) noexcept
+        {
+            return value(table[h.index]);
+        }
+        
+        // move-constructs up to n objects out of the sparsest caches; returns the number of objects moved
+        size_t compact(size_t n = std::numeric_limits<size_t>::max()) noexcept
+        {
+            return pool.compact(n, [this] (void * from, void * to) noexcept
+            {
+                slot_t * const p = static_cast<slot_t *>(from);
+                slot_t * const q = static_cast<slot_t *>(to);
+                
+                new (& q->value) T(std::move(value(p)));
+                value(p).~T();
+                
+                q->handle = p->handle;
+                table[q->handle] = q;
+            });
+        }
+        
+        size_t size() const noexcept
+        {
+            return live;
+        }
+        
+        occupancy_t occupancy()
+        {
+            return pool.occupancy();
+        }
+#ifdef CACHE_ALLOC_CHECKED
+        
+        void check() noexcept
+        {
+            pool.check();
+        }
+#endif
+    
+    private:
+        struct slot_t
+        {
+            size_t handle; // index in the table
+            typename std::aligned_storage<sizeof(T), alignof(T)>::type value;
+        };
+        
+        static T & value(slot_t * p) noexcept
+        {
+            return * std::launder(reinterpret_cast<T *>(& p->value));
+        }
+        
+        cache_pool<size_class<slot_t>::size, size_class<slot_t>::alignment, cache_size, A> pool; // general pool
+        std::vector<slot_t *, A<slot_t *>> table; // addresses of the objects, null when destroyed
+        std::vector<size_t, A<size_t>> free_handles; // indexes of the null entries
+        size_t live{};
+    };
+
+
+}
+
+
+#endif
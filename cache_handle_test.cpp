@@ -0,0 +1,103 @@
+/**
+    Cache Handle Test
+
+    Copyright 2021 Phil Bouchard <phil@fornux.com>
+
+    Distributed under the Boost Software License, Version 1.0.
+    See accompanying file LICENSE_1_0.txt or copy at
+    http://www.boost.org/LICENSE_1_0.txt
+
+    Build with: g++ -std=c++17 -g -DCACHE_ALLOC_CHECKED -fsanitize=address,undefined cache_handle_test.cpp
+    
+    Random creations, destructions and compactions of strings long enough to live on the heap, so that a relocation that does not
+    move-construct properly shows up as a wrong value, a leak or a double free.
+*/    
+
+
+#include "cache_handle.hpp"
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <map>
+
+
+template <typename P>
+    size_t test(size_t rounds)
+    {
+        P p;
+        std::map<size_t, std::pair<typename P::handle_t, std::string>> expected;
+        std::mt19937 g(2);
+        size_t errors = 0, moved = 0, id = 0;
+        
+        auto verify = [& p, & expected, & errors] ()
+        {
+            for (auto const & i : expected)
+                if (p[i.second.first] != i.second.second)
+                    ++ errors;
+            
+            if (p.size() != expected.size() || p.occupancy().live() != expected.size())
+                ++ errors;
+#ifdef CACHE_ALLOC_CHECKED
+            
+            p.check();
+#endif
+        };
+        
+        for (size_t r = 0; r < rounds; ++ r)
+        {
+            // a spike every other round
+            if (r % 2 == 0)
+                for (size_t i = 0; i < 5000; ++ i, ++ id)
+                {
+                    std::string s = "value number " + std::to_string(id) + std::string(g() % 40, 'x');
+                    
+                    expected[id] = {p.create(s), s};
+                }
+            
+            // 4 in 5 die
+            for (auto i = expected.begin(); i != expected.end(); )
+                if (g() % 5)
+                {
+                    p.destroy(i->second.first);
+                    i = expected.erase(i);
+                }
+                else
+                    ++ i;
+            
+            verify();
+            
+            if (r % 3 == 0)
+            {
+                moved += p.compact(g() % 3000);
+                verify();
+            }
+        }
+        
+        size_t const before = p.occupancy().caches.size();
+        
+        moved += p.compact();
+        verify();
+        
+        std::cout << expected.size() << " live, " << moved << " moved, " << before << " -> " << p.occupancy().caches.size() << " caches, " << errors << " errors    " << std::endl;
+        
+        return errors;
+    }
+
+int main()
+{
+    using namespace std;
+    using namespace fornux;
+    
+    size_t errors = 0;
+    
+    cout << "handle_pool relocation of std::string:    " << endl;
+    
+    cout << "on demand: ";
+    errors += test<handle_pool<string, 1>>(20);
+    
+    cout << "4 per creation: ";
+    errors += test<handle_pool<string, 1, allocator, 4>>(20);
+    
+    return errors ? 1 : 0;
+}
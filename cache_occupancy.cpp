@@ -0,0 +1,62 @@
+/**
+    Cache Occupancy Example
+
+    Copyright 2021 Phil Bouchard <phil@fornux.com>
+
+    Distributed under the Boost Software License, Version 1.0.
+    See accompanying file LICENSE_1_0.txt or copy at
+    http://www.boost.org/LICENSE_1_0.txt
+*/    
+
+
+#include "cache_alloc.hpp"
+
+#include <iostream>
+#include <string>
+#include <map>
+
+
+// a map of L elements from which 3 in 4 are erased, leaving scattered survivors
+template <typename A, size_t L>
+    void test(std::string const & name)
+    {
+        std::map<int, int, std::less<int>, A> m;
+        
+        for (size_t i = 0; i < L; ++ i)
+        {
+            m[int(i)] = int(i);
+        }
+        
+        for (size_t i = 0; i < L; ++ i)
+        {
+            if (i % 4)
+                m.erase(int(i));
+        }
+        
+        std::cout << name << " (" << m.size() << " nodes):    " << std::endl;
+        
+        // the nodes live in the pool of the rebound allocator, which m.get_allocator() does not reach
+        fornux::pool_registry::instance().dump_all(std::cout);
+        
+        std::cout << std::endl;
+    }
+
+int main(int argc, char * argv[])
+{
+    using namespace std;
+    using namespace fornux;
+    
+    size_t const LOOP_SIZE = 1024 * 12;
+    
+    test<cache_alloc<pair<int const, int>, 1>, LOOP_SIZE>("std::map with cache_alloc of 1 K");
+    test<shared_cache_alloc<pair<int const, int>, 1>, LOOP_SIZE>("std::map with shared_cache_alloc of 1 K");
+    
+    if (argc > 1 && string(argv[1]) == "json")
+    {
+        map<int, int, less<int>, shared_cache_alloc<pair<int const, int>, 1>> m{{1, 1}, {2, 2}};
+        
+        pool_registry::instance().dump_all_json(cout);
+    }
+    
+    return 0;
+}
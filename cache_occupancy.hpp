@@ -0,0 +1,124 @@
+/**
+    Cache Occupancy
+
+    Copyright 2021 Phil Bouchard <phil@fornux.com>
+
+    Distributed under the Boost Software License, Version 1.0.
+    See accompanying file LICENSE_1_0.txt or copy at
+    http://www.boost.org/LICENSE_1_0.txt
+*/
+
+
+#ifndef CACHE_OCCUPANCY_HPP
+#define CACHE_OCCUPANCY_HPP
+
+#include <array>
+#include <vector>
+#include <cstddef>
+#include <ostream>
+
+
+namespace fornux
+{
+
+
+/**
+    Occupancy map.
+
+    Snapshot of every cache of a pool, as returned by cache_pool::occupancy(), to see why memory is not released: a cache is
+    only released once all of its elements are dead.
+*/
+
+struct occupancy_t
+{
+    struct cache_info_t
+    {
+        void const * address;
+        size_t capacity; // elements
+        size_t live; // elements allocated or pending flush
+        size_t free; // elements in the free list
+        size_t untouched; // elements never allocated yet
+        bool dead; // in dead_caches, i.e. open for allocations
+    };
+
+    size_t element_size{}; // bytes of storage
+    size_t slot_size{}; // bytes of storage and header
+    size_t deferred{}; // deallocations pending flush
+    std::vector<cache_info_t> caches;
+
+    size_t live() const
+    {
+        size_t n = 0;
+
+        for (cache_info_t const & i : caches)
+            n += i.live;
+
+        return n;
+    }
+
+    size_t capacity() const
+    {
+        size_t n = 0;
+
+        for (cache_info_t const & i : caches)
+            n += i.capacity;
+
+        return n;
+    }
+
+    // caches per occupancy decile, i.e. [0] = empty, [1] = up to 10% live, ..., [10] = full
+    std::array<size_t, 11> histogram() const
+    {
+        std::array<size_t, 11> h{};
+
+        for (cache_info_t const & i : caches)
+            ++ h[i.live == 0 ? 0 : i.live == i.capacity ? 10 : 1 + (i.live * 10 - 1) / i.capacity];
+
+        return h;
+    }
+
+    void dump(std::ostream & out) const
+    {
+        std::array<size_t, 11> h = histogram();
+
+        out << caches.size() << " caches of " << (caches.empty() ? 0 : caches.front().capacity) << " x " << slot_size << " B, ";
+        out << live() << " / " << capacity() << " elements live, " << deferred << " deferred\n";
+
+        for (cache_info_t const & i : caches)
+            out << "  " << i.address << ": " << i.live << " live, " << i.free << " free, " << i.untouched << " untouched" << (i.dead ? ", dead" : "") << "\n";
+
+        out << "  occupancy: 0% " << h[0];
+
+        for (size_t i = 1; i < 10; ++ i)
+            out << ", " << i * 10 << "% " << h[i];
+
+        out << ", 100% " << h[10] << "\n";
+    }
+
+    void dump_json(std::ostream & out) const
+    {
+        std::array<size_t, 11> h = histogram();
+
+        out << "{\"element_size\": " << element_size << ", \"slot_size\": " << slot_size << ", \"live\": " << live() << ", \"capacity\": " << capacity() << ", \"deferred\": " << deferred << ", \"caches\": [";
+
+        for (size_t i = 0; i < caches.size(); ++ i)
+        {
+            cache_info_t const & c = caches[i];
+
+            out << (i ? ", " : "") << "{\"address\": \"" << c.address << "\", \"capacity\": " << c.capacity << ", \"live\": " << c.live << ", \"free\": " << c.free << ", \"untouched\": " << c.untouched << ", \"dead\": " << (c.dead ? "true" : "false") << "}";
+        }
+
+        out << "], \"histogram\": [";
+
+        for (size_t i = 0; i < h.size(); ++ i)
+            out << (i ? ", " : "") << h[i];
+
+        out << "]}\n";
+    }
+};
+
+
+}
+
+
+#endif
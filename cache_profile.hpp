@@ -0,0 +1,210 @@
+/**
+    Cache Profile
+
+    Copyright 2021 Phil Bouchard <phil@fornux.com>
+
+    Distributed under the Boost Software License, Version 1.0.
+    See accompanying file LICENSE_1_0.txt or copy at
+    http://www.boost.org/LICENSE_1_0.txt
+
+    Sampling heap profiler, built in with -DCACHE_ALLOC_PROFILE:
+    - cache_alloc samples one allocation every $CACHE_ALLOC_PROFILE_RATE bytes on average (512 KB by default) with
+      exponentially distributed gaps, records its stack trace and element type and keeps it until it is deallocated;
+    - heap_profiler::instance().dump() writes the live samples in the gperftools heap_v2 text format that pprof reads, i.e.
+      "pprof --text ./program heap.prof", and dump_types() a summary per element type.  The live heap is also written to
+      $CACHE_ALLOC_PROFILE_OUTPUT at exit when it is set.
+
+    Unsampled allocations only pay for a thread local countdown and deallocations for a test of the element header.
+*/
+
+
+#ifndef CACHE_PROFILE_HPP
+#define CACHE_PROFILE_HPP
+
+#ifdef CACHE_ALLOC_PROFILE
+#include <map>
+#include <cmath>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdlib>
+#include <cstdint>
+#include <execinfo.h>
+
+#include "intrusive_list.hpp"
+#include "cache_tune.hpp"
+
+
+namespace fornux
+{
+
+
+struct heap_profiler
+{
+    static constexpr int max_depth = 32;
+
+    struct sample_t
+    {
+        boost::smart_ptr::detail::intrusive_list_node live_node;
+        size_t size;
+        char const * type;
+        int depth;
+        void * stack[max_depth];
+    };
+
+    // geometric spacing: true once every rate bytes on average
+    static bool sample(size_t size) noexcept __attribute__((always_inline))
+    {
+        thread_local long countdown = 0;
+
+        if ((countdown -= long(size)) > 0)
+            return false;
+
+        countdown = interval();
+
+        return true;
+    }
+
+    template <typename T>
+        __attribute__((noinline)) sample_t * record(size_t size)
+        {
+            static std::string const type = type_name<T>();
+
+            sample_t * p = new sample_t;
+
+            p->size = size;
+            p->type = type.c_str();
+            p->depth = backtrace(p->stack, max_depth);
+
+            std::lock_guard<std::mutex> lock(mutex);
+
+            live.push_back(& p->live_node);
+
+            return p;
+        }
+
+    void erase(void * q) noexcept
+    {
+        sample_t * p = static_cast<sample_t *>(q);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            p->live_node.erase();
+        }
+
+        delete p;
+    }
+
+    void dump(std::ostream & out)
+    {
+        std::map<std::vector<void *>, std::pair<size_t, size_t>> stacks;
+        size_t objects = 0, bytes = 0;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            for (boost::smart_ptr::detail::intrusive_list::iterator<sample_t, & sample_t::live_node> i = live.begin(); i != live.end(); ++ i)
+            {
+                // skip record()
+                std::pair<size_t, size_t> & s = stacks[std::vector<void *>(i->stack + 1, i->stack + i->depth)];
+
+                ++ s.first;
+                s.second += i->size;
+                ++ objects;
+                bytes += i->size;
+            }
+        }
+
+        out << "heap profile: " << objects << ": " << bytes << " [" << objects << ": " << bytes << "] @ heap_v2/" << rate() << "\n";
+
+        for (auto const & i : stacks)
+        {
+            out << i.second.first << ": " << i.second.second << " [" << i.second.first << ": " << i.second.second << "] @";
+
+            for (void * p : i.first)
+                out << " " << p;
+
+            out << "\n";
+        }
+
+        out << "\nMAPPED_LIBRARIES:\n";
+        out << std::ifstream("/proc/self/maps").rdbuf();
+    }
+
+    void dump(char const * path)
+    {
+        std::ofstream out(path);
+
+        dump(out);
+    }
+
+    void dump_types(std::ostream & out)
+    {
+        std::map<std::string, std::pair<size_t, size_t>> types;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            for (boost::smart_ptr::detail::intrusive_list::iterator<sample_t, & sample_t::live_node> i = live.begin(); i != live.end(); ++ i)
+            {
+                std::pair<size_t, size_t> & s = types[i->type];
+
+                ++ s.first;
+                s.second += i->size;
+            }
+        }
+
+        out << "sampled objects,sampled bytes,type\n";
+
+        for (auto const & i : types)
+            out << i.second.first << "," << i.second.second << ",\"" << i.first << "\"\n";
+    }
+
+    static heap_profiler & instance()
+    {
+        static heap_profiler p;
+
+        return p;
+    }
+
+    ~heap_profiler()
+    {
+        if (char const * path = std::getenv("CACHE_ALLOC_PROFILE_OUTPUT"))
+            dump(path);
+    }
+
+private:
+    std::mutex mutex;
+    boost::smart_ptr::detail::intrusive_list live; // samples not deallocated yet
+
+    static long rate()
+    {
+        static long const r = std::getenv("CACHE_ALLOC_PROFILE_RATE") ? std::atol(std::getenv("CACHE_ALLOC_PROFILE_RATE")) : 512 * 1024;
+
+        return r > 0 ? r : 1;
+    }
+
+    // exponentially distributed number of bytes until the next sample
+    static long interval()
+    {
+        thread_local uint64_t x = reinterpret_cast<uintptr_t>(& x) | 1;
+
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+
+        double u = (double(x >> 11) + 1.0) / 9007199254740993.0;
+
+        return long(- std::log(u) * rate()) + 1;
+    }
+};
+
+
+}
+
+#endif
+
+
+#endif
@@ -0,0 +1,259 @@
+/**
+    Cache Promise Benchmark
+
+    Copyright 2021 Phil Bouchard <phil@fornux.com>
+
+    Distributed under the Boost Software License, Version 1.0.
+    See accompanying file LICENSE_1_0.txt or copy at
+    http://www.boost.org/LICENSE_1_0.txt
+*/    
+
+
+#include "cache_promise.hpp"
+
+#include <iostream>
+#include <chrono>
+#include <coroutine>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+struct heap_promise
+{
+};
+
+template <typename B>
+    struct task
+    {
+        struct promise_type : B
+        {
+            int value{};
+            
+            task get_return_object()
+            {
+                return task{std::coroutine_handle<promise_type>::from_promise(* this)};
+            }
+            
+            std::suspend_always initial_suspend() noexcept 
+            { 
+                return {}; 
+            }
+            
+            std::suspend_always final_suspend() noexcept 
+            { 
+                return {}; 
+            }
+            
+            void return_value(int v)
+            {
+                value = v;
+            }
+            
+            void unhandled_exception()
+            {
+                throw;
+            }
+        };
+        
+        std::coroutine_handle<promise_type> h;
+        
+        task(task const &) = delete;
+        
+        task(task && x) 
+        : h(std::exchange(x.h, {}))
+        {
+        }
+        
+        ~task()
+        {
+            if (h)
+                h.destroy();
+        }
+        
+        int get()
+        {
+            h.resume();
+            
+            return h.promise().value;
+        }
+        
+    private:
+        explicit task(std::coroutine_handle<promise_type> h)
+        : h(h)
+        {
+        }
+    };
+
+template <typename B>
+    task<B> leaf(int i)
+    {
+        co_return i;
+    }
+    
+template <typename B>
+    task<B> node(int i)
+    {
+        // a bigger frame in another size class
+        int a[16];
+        
+        for (int j = 0; j < 16; ++ j)
+            a[j] = i + j;
+        
+        co_return a[i % 16];
+    }
+
+template <typename B, size_t L>
+    auto test1()
+    {
+        long sum = 0;
+        
+        auto start = std::chrono::steady_clock::now();
+        
+        {
+            for (size_t i = 0; i < L; ++ i)
+            {
+                sum += leaf<B>(i).get();
+            }
+        }
+        
+        auto end = std::chrono::steady_clock::now();
+        
+        if (sum == 0)
+            std::cerr << "";
+        
+        return std::chrono::duration<double>{end - start};
+    }
+
+template <typename B, size_t L>
+    auto test2()
+    {
+        long sum = 0;
+        
+        auto start = std::chrono::steady_clock::now();
+        
+        {
+            for (size_t i = 0; i < L; ++ i)
+            {
+                auto t1 = leaf<B>(i);
+                auto t2 = node<B>(i);
+                auto t3 = leaf<B>(i);
+                
+                sum += t1.get() + t2.get() + t3.get();
+            }
+        }
+        
+        auto end = std::chrono::steady_clock::now();
+        
+        if (sum == 0)
+            std::cerr << "";
+        
+        return std::chrono::duration<double>{end - start};
+    }
+
+// frames spawned by one thread and completed then destroyed by another, as with I/O coroutines handed to an executor
+template <typename B, size_t L>
+    auto test3(size_t threads)
+    {
+        std::mutex mutex;
+        std::deque<task<B>> ready;
+        std::atomic<long> sum{0};
+        std::vector<std::thread> pool;
+        
+        auto start = std::chrono::steady_clock::now();
+        
+        {
+            for (size_t i = 0; i < threads; ++ i)
+            {
+                pool.emplace_back([& mutex, & ready] 
+                { 
+                    for (size_t j = 0; j < L; ++ j)
+                    {
+                        auto t = node<B>(j);
+                        
+                        std::lock_guard<std::mutex> lock(mutex);
+                        
+                        ready.push_back(std::move(t));
+                    }
+                });
+                pool.emplace_back([& mutex, & ready, & sum]
+                {
+                    long s = 0;
+                    
+                    for (size_t j = 0; j < L; )
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        
+                        if (ready.empty())
+                        {
+                            lock.unlock();
+                            std::this_thread::yield();
+                            continue;
+                        }
+                        
+                        auto t = std::move(ready.front());
+                        
+                        ready.pop_front();
+                        lock.unlock();
+                        
+                        s += t.get();
+                        ++ j;
+                    }
+                    
+                    sum += s;
+                });
+            }
+            
+            for (auto & t : pool)
+            {
+                t.join();
+            }
+        }
+        
+        auto end = std::chrono::steady_clock::now();
+        
+        if (sum == 0)
+            std::cerr << "";
+        
+        return std::chrono::duration<double>{end - start};
+    }
+
+int main()
+{
+    using namespace std;
+    using namespace fornux;
+    
+    size_t const LOOP_SIZE = 1024 * 1000 * 4;
+    
+    {
+        cout << "cache_promise speedup factor (spawn / complete):    " << endl;
+        
+        auto s = test1<heap_promise, LOOP_SIZE>();
+        
+        cout << "cache_promise of 1 K: " << s / test1<cache_promise<1>, LOOP_SIZE>() << "x    " << endl;
+        cout << "cache_promise of 10 K: " << s / test1<cache_promise<10>, LOOP_SIZE>() << "x    " << endl;
+    }
+    
+    {
+        cout << "cache_promise speedup factor (3 interleaved spawn / complete):    " << endl;
+        
+        auto s = test2<heap_promise, LOOP_SIZE>();
+        
+        cout << "cache_promise of 1 K: " << s / test2<cache_promise<1>, LOOP_SIZE>() << "x    " << endl;
+        cout << "cache_promise of 10 K: " << s / test2<cache_promise<10>, LOOP_SIZE>() << "x    " << endl;
+    }
+    
+    for (size_t threads = 1; threads <= max(1u, thread::hardware_concurrency() / 2); threads *= 2)
+    {
+        cout << "cache_promise speedup factor (" << threads << " spawning / " << threads << " completing threads):    " << endl;
+        
+        auto s = test3<heap_promise, LOOP_SIZE / 4>(threads);
+        
+        cout << "cache_promise of 1 K: " << s / test3<cache_promise<1>, LOOP_SIZE / 4>(threads) << "x    " << endl;
+        cout << "cache_promise of 10 K: " << s / test3<cache_promise<10>, LOOP_SIZE / 4>(threads) << "x    " << endl;
+    }
+    
+    return 0;
+}
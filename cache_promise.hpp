@@ -0,0 +1,219 @@
+/**
+    Cache Promise
+
+    Copyright 2021 Phil Bouchard <phil@fornux.com>
+
+    Distributed under the Boost Software License, Version 1.0.
+    See accompanying file LICENSE_1_0.txt or copy at
+    http://www.boost.org/LICENSE_1_0.txt
+*/
+
+
+#ifndef CACHE_PROMISE_HPP
+#define CACHE_PROMISE_HPP
+
+#include <new>
+#include <atomic>
+#include <utility>
+#include "cache_alloc.hpp"
+#include "lockfree.hpp"
+
+
+namespace fornux
+{
+
+
+/**
+    Size class dispatcher.
+    
+    Routes blocks whose size is only known at runtime (e.g. coroutine frames) to a cache_pool of the matching size class: N classes
+    spaced G bytes apart.  Bigger blocks fall back to the global heap.
+    
+    I/O coroutines are usually created on one thread and destroyed on another, so each thread allocates from pools of its own and
+    a G byte header records the owner of each block.  The owner releases its blocks straight into its pools; other threads push
+    them on a lock-free stack of the owner, which takes them back on its next allocation of that class.  The pools of a thread
+    outlive it until the last of its blocks is released.
+*/
+
+template <size_t S, template <typename...> class A = std::allocator, size_t G = __STDCPP_DEFAULT_NEW_ALIGNMENT__, size_t N = 64> // cache size, allocator, size class granularity and count
+    struct cache_frame_alloc
+    {
+        static void * allocate(size_t size)
+        {
+            if (size == 0 || size > G * (N - 1))
+                return ::operator new(size);
+                
+            heap_t * const h = local();
+            header_t * const p = static_cast<header_t *>(classes.table[(size - 1) / G + 1].allocate(h));
+            
+            p->owner = h;
+            ++ h->outstanding;
+            
+            return reinterpret_cast<char *>(p) + G;
+        }
+        
+        static void deallocate(void * q, size_t size) noexcept
+        {
+            if (size == 0 || size > G * (N - 1))
+                return ::operator delete(q, size);
+                
+            header_t * const p = reinterpret_cast<header_t *>(static_cast<char *>(q) - G);
+            heap_t * const h = p->owner;
+            size_t const i = (size - 1) / G + 1;
+            
+            if (h == current())
+            {
+                -- h->outstanding;
+                classes.table[i].deallocate(h, p);
+            }
+            else
+            {
+                h->remote[i].push(new (p) remote_t);
+                
+                // the owner is gone and this was its last block
+                if (h->balance.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    delete h;
+            }
+        }
+        
+    private:
+        struct heap_t;
+        
+        struct header_t
+        {
+            heap_t * owner;
+        };
+        
+        // block released by another thread than its owner
+        struct remote_t
+        {
+            std::atomic<uint64_t> next{0};
+        };
+        
+        struct class_t
+        {
+            void * (* allocate)(heap_t *);
+            void (* deallocate)(heap_t *, void *);
+            void (* destroy)(void *);
+        };
+        
+        // pools of a thread
+        struct heap_t
+        {
+            void * pools[N]{}; // created on first use
+            intrusive_stack<remote_t> remote[N]; // blocks released by other threads
+            long outstanding{}; // blocks allocated minus blocks released by the owner
+            std::atomic<long> balance{0}; // minus blocks released by other threads, plus outstanding once the owner is gone
+            
+            ~heap_t()
+            {
+                for (size_t i = 0; i < N; ++ i)
+                    if (pools[i])
+                        classes.table[i].destroy(pools[i]);
+            }
+        };
+        
+        struct owner_t
+        {
+            heap_t * const heap = new heap_t;
+            
+            owner_t()
+            {
+                current() = heap;
+            }
+            
+            ~owner_t()
+            {
+                current() = nullptr;
+                
+                if (heap->balance.fetch_add(heap->outstanding, std::memory_order_acq_rel) + heap->outstanding == 0)
+                    delete heap;
+            }
+        };
+        
+        static heap_t *& current() noexcept
+        {
+            thread_local heap_t * h = nullptr;
+            
+            return h;
+        }
+        
+        static heap_t * local()
+        {
+            thread_local owner_t o;
+            
+            return o.heap;
+        }
+        
+        template <size_t I>
+            using pool_t = cache_pool<(I + 1) * G, G, S, A>;
+        
+        template <size_t I>
+            static void * allocate_class(heap_t * h)
+            {
+                // private to the thread, hence not enlisted in the pool_registry
+                if (! h->pools[I])
+                    h->pools[I] = new pool_t<I>(unregistered_t());
+                    
+                pool_t<I> * const p = static_cast<pool_t<I> *>(h->pools[I]);
+                
+                // take back the blocks released by other threads
+                while (remote_t * q = h->remote[I].pop())
+                    p->deallocate(q, 1);
+                    
+                return p->allocate(1);
+            }
+        
+        template <size_t I>
+            static void deallocate_class(heap_t * h, void * p)
+            {
+                static_cast<pool_t<I> *>(h->pools[I])->deallocate(p, 1);
+            }
+        
+        template <size_t I>
+            static void destroy_class(void * p)
+            {
+                delete static_cast<pool_t<I> *>(p);
+            }
+        
+        struct classes_t
+        {
+            class_t table[N];
+            
+            template <size_t... I>
+                constexpr classes_t(std::index_sequence<I...>)
+                : table{{& allocate_class<I>, & deallocate_class<I>, & destroy_class<I>}...}
+                {
+                }
+        };
+        
+        static constexpr classes_t classes{std::make_index_sequence<N>()};
+    };
+
+
+/**
+    Coroutine promise base.
+    
+    Derive a promise_type from it to have the coroutine frames allocated from the size class pools instead of the global heap.  The
+    frame size is given back to the sized operator delete to find the size class on release.  Frames may be released by another
+    thread than the one that created them.
+*/
+
+template <size_t S, template <typename...> class A = std::allocator> // cache size and allocator
+    struct cache_promise
+    {
+        static void * operator new(size_t size)
+        {
+            return cache_frame_alloc<S, A>::allocate(size);
+        }
+        
+        static void operator delete(void * p, size_t size) noexcept
+        {
+            cache_frame_alloc<S, A>::deallocate(p, size);
+        }
+    };
+
+}
+
+
+#endif
@@ -0,0 +1,137 @@
+/**
+    Cache Registry
+
+    Copyright 2021 Phil Bouchard <phil@fornux.com>
+
+    Distributed under the Boost Software License, Version 1.0.
+    See accompanying file LICENSE_1_0.txt or copy at
+    http://www.boost.org/LICENSE_1_0.txt
+*/
+
+
+#ifndef CACHE_REGISTRY_HPP
+#define CACHE_REGISTRY_HPP
+
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#include "intrusive_list.hpp"
+#include "cache_occupancy.hpp"
+
+
+namespace fornux
+{
+
+
+// tag of the pools that stay out of the registry
+struct unregistered_t
+{
+};
+
+
+/**
+    Pool registry.
+
+    Every live cache_pool enlists itself here.  Containers allocate their nodes through a rebound allocator of another size class,
+    which their own allocator cannot reach, so this is how those pools get flushed and inspected.  Walking them is only safe while
+    no other thread is using them: pools that are locked by their owner or private to a thread, i.e. those of lockfree.hpp and
+    cache_promise.hpp, are constructed with unregistered_t to stay out.  Enlisting takes a global mutex, once per pool.
+*/
+
+struct pool_registry
+{
+    struct node_t
+    {
+        boost::smart_ptr::detail::intrusive_list_node registry_node;
+        void (* flush)(node_t *) noexcept;
+        occupancy_t (* occupancy)(node_t *);
+    };
+    
+    void insert(node_t * p)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        
+        pools.push_back(& p->registry_node);
+    }
+    
+    void erase(node_t * p) noexcept
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        
+        p->registry_node.erase();
+    }
+    
+    // releases the deferred deallocations of every pool
+    void flush_all() noexcept
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        
+        for (boost::smart_ptr::detail::intrusive_list::iterator<node_t, & node_t::registry_node> i = pools.begin(); i != pools.end(); ++ i)
+            i->flush(& * i);
+    }
+    
+    // snapshot of every pool
+    std::vector<occupancy_t> occupancy()
+    {
+        std::vector<occupancy_t> o;
+        std::lock_guard<std::mutex> lock(mutex);
+        
+        for (boost::smart_ptr::detail::intrusive_list::iterator<node_t, & node_t::registry_node> i = pools.begin(); i != pools.end(); ++ i)
+            o.push_back(i->occupancy(& * i));
+        
+        return o;
+    }
+    
+    // occupancy map of every pool holding elements
+    void dump_all(std::ostream & out)
+    {
+        size_t idle = 0;
+        
+        for (occupancy_t const & o : occupancy())
+        {
+            if (o.live() == 0 && o.deferred == 0)
+            {
+                ++ idle;
+                continue;
+            }
+            
+            out << o.element_size << " B elements: ";
+            o.dump(out);
+        }
+        
+        out << idle << " idle pools\n";
+    }
+    
+    void dump_all_json(std::ostream & out)
+    {
+        std::vector<occupancy_t> const pools = occupancy();
+        
+        out << "[";
+        
+        for (size_t i = 0; i < pools.size(); ++ i)
+        {
+            out << (i ? ", " : "");
+            pools[i].dump_json(out);
+        }
+        
+        out << "]\n";
+    }
+    
+    static pool_registry & instance()
+    {
+        static pool_registry r;
+        
+        return r;
+    }
+    
+private:
+    std::mutex mutex;
+    boost::smart_ptr::detail::intrusive_list pools; // live pools
+};
+
+
+}
+
+
+#endif
@@ -0,0 +1,214 @@
+/**
+    Cache Tune
+
+    Copyright 2021 Phil Bouchard <phil@fornux.com>
+
+    Distributed under the Boost Software License, Version 1.0.
+    See accompanying file LICENSE_1_0.txt or copy at
+    http://www.boost.org/LICENSE_1_0.txt
+
+    Profile-guided cache sizes:
+    - build a training run with -DCACHE_ALLOC_TUNE; at exit it writes the header named by $CACHE_ALLOC_TUNE_OUTPUT
+      (cache_tuned.hpp by default) with a recommended cache size for every element type allocated through cache_alloc;
+    - build production with -DCACHE_ALLOC_TUNED='"cache_tuned.hpp"' and declare the allocators with a cache size of 0, i.e.
+      cache_alloc<T, 0>, to pick them up.  Types missing from the table get the default cache size.
+
+    Types are matched by a hash of their compiler spelling so both builds must use the same compiler and standard library.
+*/
+
+
+#ifndef CACHE_TUNE_HPP
+#define CACHE_TUNE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#ifdef CACHE_ALLOC_TUNE
+#include <map>
+#include <mutex>
+#include <fstream>
+#include <cstdlib>
+#endif
+
+
+namespace fornux
+{
+
+
+struct tune_entry_t
+{
+    uint64_t hash;
+    size_t size;
+};
+
+
+}
+
+#ifdef CACHE_ALLOC_TUNED
+#include CACHE_ALLOC_TUNED
+#else
+namespace fornux
+{
+
+namespace tuned
+{
+
+constexpr tune_entry_t table[] = {{0, 0}};
+
+}
+
+}
+#endif
+
+
+namespace fornux
+{
+
+
+/**
+    Type signature.
+
+    FNV-1a hash of the compiler spelling of T, so that generated tables can refer to types (i.e. container nodes) without having
+    to name them.
+*/
+
+template <typename T>
+    constexpr uint64_t type_hash()
+    {
+        uint64_t h = 14695981039346656037ull;
+
+        for (char const * p = __PRETTY_FUNCTION__; * p; ++ p)
+        {
+            h ^= uint8_t(* p);
+            h *= 1099511628211ull;
+        }
+
+        return h;
+    }
+
+
+template <typename T, size_t D = 10> // type and default cache size
+    constexpr size_t tuned_cache_size()
+    {
+        for (tune_entry_t const & e : tuned::table)
+            if (e.size && e.hash == type_hash<T>())
+                return e.size;
+
+        return D;
+    }
+
+
+template <typename T>
+    std::string type_name()
+    {
+        std::string s = __PRETTY_FUNCTION__;
+        size_t b = s.find("T = ") + 4;
+        size_t e = s.find_first_of(";]", b);
+
+        return s.substr(b, e - b);
+    }
+
+#ifdef CACHE_ALLOC_TUNE
+
+/**
+    Training run registry.
+
+    Collects the statistics of every cache_alloc pool when its allocator goes away and writes the generated header at exit.
+*/
+
+struct tune_registry
+{
+    struct record_t
+    {
+        std::string name;
+        size_t element_size{};
+        size_t cache_size{};
+        size_t instances{};
+        size_t high_water{};
+        size_t created{};
+        size_t released{};
+        uint64_t element_time{};
+        uint64_t cache_time{};
+    };
+
+    template <typename T, typename U>
+        void record(size_t element_size, size_t cache_size, U const & stats)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            record_t & r = records[type_hash<T>()];
+
+            if (r.name.empty())
+                r.name = type_name<T>();
+
+            r.element_size = element_size;
+            r.cache_size = cache_size;
+            ++ r.instances;
+
+            if (stats.high_water > r.high_water)
+                r.high_water = stats.high_water;
+
+            r.created += stats.created;
+            r.released += stats.released;
+            r.element_time += stats.element.time;
+            r.cache_time += stats.cache.time;
+        }
+
+    // peak live set spread over about 4 caches, doubled when caches keep being recreated or cost over 10% of the time
+    static size_t recommend(record_t const & r)
+    {
+        size_t s = (r.high_water + 4 * 1024 - 1) / (4 * 1024);
+        size_t peak = (r.high_water + r.cache_size * 1024 - 1) / (r.cache_size * 1024);
+
+        if (s == 0)
+            s = 1;
+
+        if (r.created > 4 * r.instances * (peak ? peak : 1) || r.cache_time * 10 > r.element_time + r.cache_time)
+            s *= 2;
+
+        return s;
+    }
+
+    static tune_registry & instance()
+    {
+        static tune_registry r;
+
+        return r;
+    }
+
+    ~tune_registry()
+    {
+        char const * path = std::getenv("CACHE_ALLOC_TUNE_OUTPUT");
+        std::ofstream out(path ? path : "cache_tuned.hpp");
+
+        out << "/**\n    Generated by the cache_alloc tuner: do not edit.\n*/\n\n\n";
+        out << "#ifndef CACHE_TUNED_HPP\n#define CACHE_TUNED_HPP\n\n\n";
+        out << "namespace fornux\n{\n\nnamespace tuned\n{\n\n";
+        out << "constexpr tune_entry_t table[] =\n{\n";
+
+        for (auto const & i : records)
+        {
+            record_t const & r = i.second;
+            uint64_t total = r.element_time + r.cache_time;
+
+            out << "    {0x" << std::hex << i.first << std::dec << "ull, " << recommend(r) << "}, // " << r.name << ": ";
+            out << r.element_size << " B elements, " << r.instances << " instance(s), high water " << r.high_water << ", ";
+            out << r.created << " / " << r.released << " caches created / released, ";
+            out << (total ? 100 * r.cache_time / total : 0) << "% cache time, trained with " << r.cache_size << " K\n";
+        }
+
+        out << "    {0, 0}\n};\n\n}\n\n}\n\n\n#endif\n";
+    }
+
+private:
+    std::mutex mutex;
+    std::map<uint64_t, record_t> records;
+};
+
+#endif
+
+}
+
+
+#endif
@@ -13,6 +13,8 @@
 #define LIST_HPP
 
 
+#include <memory>
+
 #include "intrusive_list.hpp"
 
 
@@ -25,7 +27,7 @@ template <typename T, typename A = std::allocator<T>>
     {
         struct iterator;
         
-        list(size_t s = 0) : s(s)
+        list(size_t s = 0)
         {
             for (size_t i = 0; i < s; ++ i)
                 emplace_back();
@@ -50,8 +52,6 @@ template <typename T, typename A = std::allocator<T>>
         
         void pop_back()
         {
-            -- s;
-            
             erase(rbegin());
         }
         
@@ -66,22 +66,22 @@ template <typename T, typename A = std::allocator<T>>
         
         iterator begin()
         {
-            return & boost::smart_ptr::detail::classof(& node_t::list_node, elements.begin())->element;
+            return boost::smart_ptr::detail::classof(& node_t::list_node, elements.begin());
         }
 
         iterator end()
         {
-            return & boost::smart_ptr::detail::classof(& node_t::list_node, elements.end())->element;
+            return boost::smart_ptr::detail::classof(& node_t::list_node, elements.end());
         }
         
         iterator rbegin()
         {
-            return & boost::smart_ptr::detail::classof(& node_t::list_node, elements.rbegin())->element;
+            return boost::smart_ptr::detail::classof(& node_t::list_node, elements.rbegin());
         }
 
         iterator rend()
         {
-            return & boost::smart_ptr::detail::classof(& node_t::list_node, elements.rend())->element;
+            return boost::smart_ptr::detail::classof(& node_t::list_node, elements.rend());
         }
         
         ~list()
@@ -89,7 +89,10 @@ template <typename T, typename A = std::allocator<T>>
             for (boost::smart_ptr::detail::intrusive_list::iterator<node_t, & node_t::list_node> m = elements.begin(), n = elements.begin(); m != elements.end(); m = n)
             {
                 ++ n;
-                delete &* m;
+                
+                m->~node_t();
+                
+                a.deallocate(&* m, 1);
             }
         }
 
@@ -109,7 +112,7 @@ template <typename T, typename A = std::allocator<T>>
                 }
         };
 
-        typename A::template rebind<node_t>::other a;
+        typename std::allocator_traits<A>::template rebind_alloc<node_t> a;
         
     public:
         struct iterator
@@ -126,6 +129,11 @@ template <typename T, typename A = std::allocator<T>>
             {
             }
             
+            iterator(node_t * p)
+            : p(p)
+            {
+            }
+            
             iterator(iterator const & p)
             : p(p.p)
             {
@@ -0,0 +1,139 @@
+/**
+    Lock-free Containers Benchmark
+
+    Copyright 2021 Phil Bouchard <phil@fornux.com>
+
+    Distributed under the Boost Software License, Version 1.0.
+    See accompanying file LICENSE_1_0.txt or copy at
+    http://www.boost.org/LICENSE_1_0.txt
+*/    
+
+
+#include "lockfree.hpp"
+
+#include <iostream>
+#include <chrono>
+#include <deque>
+#include <vector>
+#include <thread>
+
+
+template <typename T>
+    struct mutex_queue
+    {
+        void push(T const & value)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            
+            c.push_back(value);
+        }
+        
+        bool pop(T & value)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            
+            if (c.empty())
+                return false;
+                
+            value = c.front();
+            c.pop_front();
+            
+            return true;
+        }
+        
+    private:
+        std::mutex mutex;
+        std::deque<T> c;
+    };
+
+template <typename T>
+    struct mutex_stack
+    {
+        void push(T const & value)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            
+            c.push_back(value);
+        }
+        
+        bool pop(T & value)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            
+            if (c.empty())
+                return false;
+                
+            value = c.back();
+            c.pop_back();
+            
+            return true;
+        }
+        
+    private:
+        std::mutex mutex;
+        std::vector<T> c;
+    };
+
+// producers push L items each while as many consumers pop them all
+template <typename C, size_t L>
+    auto test(size_t threads)
+    {
+        C c;
+        std::atomic<size_t> popped{0};
+        std::atomic<long> sum{0};
+        std::vector<std::thread> pool;
+
+        auto start = std::chrono::steady_clock::now();
+        
+        {
+            for (size_t i = 0; i < threads; ++ i)
+            {
+                pool.emplace_back([& c] { for (size_t j = 0; j < L; ++ j) c.push(long(j)); });
+                pool.emplace_back([& c, & popped, & sum, threads] 
+                { 
+                    long s = 0, v;
+                    
+                    while (popped.load(std::memory_order_relaxed) < threads * L)
+                        if (c.pop(v))
+                        {
+                            s += v;
+                            popped.fetch_add(1, std::memory_order_relaxed);
+                        }
+                        else
+                            std::this_thread::yield();
+                        
+                    sum += s;
+                });
+            }
+            
+            for (auto & t : pool)
+            {
+                t.join();
+            }
+        }
+        
+        auto end = std::chrono::steady_clock::now();
+        
+        if (sum != long(threads * L * (L - 1) / 2))
+            std::cerr << "(lost elements) ";
+
+        return std::chrono::duration<double>{end - start};
+    }
+
+int main()
+{
+    using namespace std;
+    using namespace fornux;
+    
+    size_t const LOOP_SIZE = 1024 * 1000;
+    
+    for (size_t threads = 1; threads <= max(1u, thread::hardware_concurrency()); threads *= 2)
+    {
+        cout << "lock-free speedup factor (" << threads << " producers / " << threads << " consumers):    " << endl;
+        
+        cout << "fornux::queue: " << test<mutex_queue<long>, LOOP_SIZE>(threads) / test<fornux::queue<long>, LOOP_SIZE>(threads) << "x    " << endl;
+        cout << "fornux::stack: " << test<mutex_stack<long>, LOOP_SIZE>(threads) / test<fornux::stack<long>, LOOP_SIZE>(threads) << "x    " << endl;
+    }
+    
+    return 0;
+}
@@ -0,0 +1,284 @@
+/**
+    Lock-free Containers
+
+    Copyright 2021 Phil Bouchard <phil@fornux.com>
+
+    Distributed under the Boost Software License, Version 1.0.
+    See accompanying file LICENSE_1_0.txt or copy at
+    http://www.boost.org/LICENSE_1_0.txt
+*/
+
+
+#ifndef LOCKFREE_HPP
+#define LOCKFREE_HPP
+
+#include <new>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+#include "cache_alloc.hpp"
+
+
+namespace fornux
+{
+
+
+/**
+    Tagged pointer.
+
+    Pointer in the low 48 bits and a modification count in the high 16 bits of a single word, so that a compare-and-swap fails
+    when the pointer was popped and pushed back in between (ABA).  Relies on user space addresses fitting in 48 bits, as on
+    x86-64 and AArch64.
+*/
+
+template <typename T>
+    struct tagged
+    {
+        static_assert(sizeof(void *) == sizeof(uint64_t), "tagged pointers need 64 bit addresses");
+
+        static constexpr uint64_t mask = (uint64_t(1) << 48) - 1;
+
+        static T * get(uint64_t w) noexcept
+        {
+            return reinterpret_cast<T *>(w & mask);
+        }
+
+        static uint64_t tag(uint64_t w) noexcept
+        {
+            return w >> 48;
+        }
+
+        static uint64_t make(T * p, uint64_t tag) noexcept
+        {
+            return (reinterpret_cast<uint64_t>(p) & mask) | (tag << 48);
+        }
+    };
+
+
+/**
+    Intrusive lock-free stack (Treiber).
+
+    Links nodes through their tagged next word.  Popped nodes must stay readable, i.e. be recycled rather than freed, for as
+    long as the stack is used.
+*/
+
+template <typename N>
+    struct intrusive_stack
+    {
+        typedef tagged<N> ptr;
+
+        void push(N * p) noexcept
+        {
+            uint64_t top = head.load(std::memory_order_relaxed);
+            uint64_t next = p->next.load(std::memory_order_relaxed);
+
+            do
+            {
+                p->next.store(ptr::make(ptr::get(top), ptr::tag(next) + 1), std::memory_order_relaxed);
+            }
+            while (! head.compare_exchange_weak(top, ptr::make(p, ptr::tag(top) + 1), std::memory_order_release, std::memory_order_relaxed));
+        }
+
+        N * pop() noexcept
+        {
+            uint64_t top = head.load(std::memory_order_acquire);
+
+            while (N * p = ptr::get(top))
+            {
+                uint64_t next = p->next.load(std::memory_order_relaxed);
+
+                if (head.compare_exchange_weak(top, ptr::make(ptr::get(next), ptr::tag(top) + 1), std::memory_order_acquire, std::memory_order_acquire))
+                    return p;
+            }
+
+            return nullptr;
+        }
+
+    private:
+        std::atomic<uint64_t> head{0};
+    };
+
+
+/**
+    Concurrent node pool.
+
+    Recycles nodes through a lock-free free list and only takes the mutex to carve new ones out of its cache_pool, whose slots
+    are aligned to cache lines.  Nodes go back to the cache_pool when the pool is destroyed, so memory stays at its high-water
+    mark meanwhile.
+*/
+
+template <typename N, size_t S, template <typename...> class A = std::allocator> // node, cache size and allocator
+    struct node_pool
+    {
+        N * allocate()
+        {
+            if (N * p = free.pop())
+                return p;
+
+            std::lock_guard<std::mutex> lock(mutex);
+
+            return new (pool.allocate(1)) N;
+        }
+
+        void deallocate(N * p) noexcept
+        {
+            free.push(p);
+        }
+
+    private:
+        intrusive_stack<N> free;
+        std::mutex mutex;
+        cache_pool<size_class<N>::size, size_class<N>::alignment, S, A, 0, 64> pool{unregistered_t()};
+    };
+
+
+/**
+    Lock-free stack.
+
+    Multiple producers and consumers.  Like boost::lockfree, T must be trivially copyable since a value may be read while its
+    node is being recycled.
+*/
+
+template <typename T, size_t S = 1, template <typename...> class A = std::allocator> // type, cache size and allocator
+    struct stack
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+
+        void push(T const & value)
+        {
+            node_t * p = nodes.allocate();
+
+            p->value = value;
+            elements.push(p);
+        }
+
+        bool pop(T & value) noexcept
+        {
+            node_t * p = elements.pop();
+
+            if (! p)
+                return false;
+
+            value = p->value;
+            nodes.deallocate(p);
+
+            return true;
+        }
+
+    private:
+        struct node_t
+        {
+            std::atomic<uint64_t> next{0};
+            T value;
+        };
+
+        intrusive_stack<node_t> elements;
+        node_pool<node_t, S, A> nodes;
+    };
+
+
+/**
+    Lock-free queue (Michael & Scott).
+
+    Multiple producers and consumers, with tagged head, tail and next words.  Same requirement on T as stack.
+*/
+
+template <typename T, size_t S = 1, template <typename...> class A = std::allocator> // type, cache size and allocator
+    struct queue
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+
+        queue()
+        {
+            node_t * p = nodes.allocate();
+
+            head.store(ptr::make(p, 0));
+            tail.store(ptr::make(p, 0));
+        }
+
+        void push(T const & value)
+        {
+            node_t * p = nodes.allocate();
+
+            p->value = value;
+            p->next.store(ptr::make(nullptr, ptr::tag(p->next.load(std::memory_order_relaxed)) + 1), std::memory_order_relaxed);
+
+            for (;;)
+            {
+                uint64_t t = tail.load(std::memory_order_acquire);
+                uint64_t next = ptr::get(t)->next.load(std::memory_order_acquire);
+
+                if (t != tail.load(std::memory_order_acquire))
+                    continue;
+
+                if (ptr::get(next) == nullptr)
+                {
+                    // link at the end then swing the tail
+                    if (ptr::get(t)->next.compare_exchange_weak(next, ptr::make(p, ptr::tag(next) + 1), std::memory_order_release, std::memory_order_relaxed))
+                    {
+                        tail.compare_exchange_strong(t, ptr::make(p, ptr::tag(t) + 1), std::memory_order_release, std::memory_order_relaxed);
+                        return;
+                    }
+                }
+                else
+                {
+                    // help a lagging producer
+                    tail.compare_exchange_weak(t, ptr::make(ptr::get(next), ptr::tag(t) + 1), std::memory_order_release, std::memory_order_relaxed);
+                }
+            }
+        }
+
+        bool pop(T & value) noexcept
+        {
+            for (;;)
+            {
+                uint64_t h = head.load(std::memory_order_acquire);
+                uint64_t t = tail.load(std::memory_order_acquire);
+                uint64_t next = ptr::get(h)->next.load(std::memory_order_acquire);
+
+                if (h != head.load(std::memory_order_acquire))
+                    continue;
+
+                if (ptr::get(h) == ptr::get(t))
+                {
+                    if (ptr::get(next) == nullptr)
+                        return false;
+
+                    tail.compare_exchange_weak(t, ptr::make(ptr::get(next), ptr::tag(t) + 1), std::memory_order_release, std::memory_order_relaxed);
+                }
+                else
+                {
+                    // read before the node can be recycled by another consumer
+                    T v = ptr::get(next)->value;
+
+                    if (head.compare_exchange_weak(h, ptr::make(ptr::get(next), ptr::tag(h) + 1), std::memory_order_acquire, std::memory_order_relaxed))
+                    {
+                        value = v;
+                        nodes.deallocate(ptr::get(h));
+
+                        return true;
+                    }
+                }
+            }
+        }
+
+    private:
+        struct node_t
+        {
+            std::atomic<uint64_t> next{0};
+            T value;
+        };
+
+        typedef tagged<node_t> ptr;
+
+        alignas(64) std::atomic<uint64_t> head;
+        alignas(64) std::atomic<uint64_t> tail;
+        node_pool<node_t, S, A> nodes;
+    };
+
+
+}
+
+
+#endif